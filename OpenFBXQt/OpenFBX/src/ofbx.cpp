@@ -1,8 +1,10 @@
 #include "ofbx.h"
 #include "miniz.h"
+#include <algorithm>
 #include <cassert>
 #include <math.h>
 #include <ctype.h>
+#include <chrono>
 #include <memory>
 #include <numeric>
 #include <string>
@@ -24,6 +26,12 @@ struct Allocator {
 	};
 	Page* first = nullptr;
 
+	u64 getSize() const {
+		u64 size = 0;
+		for (const Page* p = first; p; p = p->header.next) size += sizeof(Page);
+		return size;
+	}
+
 	~Allocator() {
 		Page* p = first;
 		while (p) {
@@ -85,11 +93,47 @@ struct Error
 	Error() {}
 	Error(const char* msg) { s_message = msg; }
 
-	static const char* s_message;
+	// per thread, so scenes can be loaded concurrently
+	static thread_local const char* s_message;
 };
 
 
-const char* Error::s_message = "";
+thread_local const char* Error::s_message = "";
+
+
+// Statistics of the load running on this thread, null outside of load()
+static thread_local LoadStatistics* s_statistics = nullptr;
+
+
+// Processor time source of the load running on this thread, null when the application gave none
+static thread_local ThreadCpuTimeFunction s_thread_cpu_time = nullptr;
+
+
+// Adds wall and processor time of its scope to a stage of the current load
+struct StageTimer
+{
+	StageTimer(double LoadStatistics::*_time, double LoadStatistics::*_cpu_time)
+		: statistics(s_statistics)
+		, time(_time)
+		, cpu_time(_cpu_time)
+		, start(std::chrono::steady_clock::now())
+		, cpu_start(s_thread_cpu_time ? s_thread_cpu_time() : 0)
+	{
+	}
+
+	~StageTimer()
+	{
+		if (!statistics) return;
+		statistics->*time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (s_thread_cpu_time) statistics->*cpu_time += s_thread_cpu_time() - cpu_start;
+	}
+
+	LoadStatistics* statistics;
+	double LoadStatistics::*time;
+	double LoadStatistics::*cpu_time;
+	std::chrono::steady_clock::time_point start;
+	double cpu_start;
+};
 
 
 template <typename T> struct OptionalError
@@ -526,6 +570,13 @@ Object::Object(const Scene& _scene, const IElement& _element)
 
 static bool decompress(const u8* in, size_t in_size, u8* out, size_t out_size)
 {
+	StageTimer timer(&LoadStatistics::inflate_time, &LoadStatistics::inflate_cpu_time);
+	if (s_statistics)
+	{
+		s_statistics->compressed_bytes += in_size;
+		s_statistics->inflated_bytes += out_size;
+	}
+
 	mz_stream stream = {};
 	mz_inflateInit(&stream);
 
@@ -1231,8 +1282,9 @@ Shape::Shape(const Scene& _scene, const IElement& _element)
 
 struct ShapeImpl : Shape
 {
-	std::vector<Vec3> vertices;
-	std::vector<Vec3> normals;
+	std::vector<int> indices;
+	std::vector<Vec3> vertex_deltas;
+	std::vector<Vec3> normal_deltas;
 
 	ShapeImpl(const Scene& _scene, const IElement& _element)
 		: Shape(_scene, _element)
@@ -1244,9 +1296,10 @@ struct ShapeImpl : Shape
 
 
 	Type getType() const override { return Type::SHAPE; }
-	int getVertexCount() const override { return (int)vertices.size(); }
-	const Vec3* getVertices() const override { return &vertices[0]; }
-	const Vec3* getNormals() const override { return normals.empty() ? nullptr : &normals[0]; }
+	int getIndexCount() const override { return (int)indices.size(); }
+	const int* getIndices() const override { return indices.empty() ? nullptr : &indices[0]; }
+	const Vec3* getVertexDeltas() const override { return vertex_deltas.empty() ? nullptr : &vertex_deltas[0]; }
+	const Vec3* getNormalDeltas() const override { return normal_deltas.empty() ? nullptr : &normal_deltas[0]; }
 };
 
 
@@ -1590,6 +1643,8 @@ struct Scene : IScene
 		return m_videos[index].content;
 	}
 
+	const LoadStatistics& getLoadStatistics() const override { return m_statistics; }
+
 	DataView getEmbeddedFilename(int index) const override {
 		return m_videos[index].filename;
 	}
@@ -1655,6 +1710,7 @@ struct Scene : IScene
 	std::vector<TakeInfo> m_take_infos;
 	std::vector<Video> m_videos;
 	Allocator m_allocator;
+	LoadStatistics m_statistics;
 };
 
 
@@ -1729,17 +1785,28 @@ struct AnimationCurveNodeImpl : AnimationCurveNode
 			const float* values = curve.curve->getKeyValue();
 			int count = curve.curve->getKeyCount();
 
+			if (count <= 1) return count == 1 ? values[0] : default_values[idx];
 			if (fbx_time < times[0]) fbx_time = times[0];
 			if (fbx_time > times[count - 1]) fbx_time = times[count - 1];
-			for (int i = 1; i < count; ++i)
+
+			// playback is mostly monotonic, so try the key of the previous call and its neighbour
+			// before falling back to binary search
+			int i = curve.cursor;
+			if (i < 1 || i >= count || times[i - 1] > fbx_time || times[i] < fbx_time)
 			{
-				if (times[i] >= fbx_time)
+				if (i >= 1 && i + 1 < count && times[i] <= fbx_time && times[i + 1] >= fbx_time)
 				{
-					float t = float(double(fbx_time - times[i - 1]) / double(times[i] - times[i - 1]));
-					return values[i - 1] * (1 - t) + values[i] * t;
+					++i;
 				}
+				else
+				{
+					i = int(std::lower_bound(times + 1, times + count, fbx_time) - times);
+				}
+				curve.cursor = i;
 			}
-			return values[0];
+
+			float t = float(double(fbx_time - times[i - 1]) / double(times[i] - times[i - 1]));
+			return values[i - 1] * (1 - t) + values[i] * t;
 		};
 
 		return {getCoord(curves[0], fbx_time, 0), getCoord(curves[1], fbx_time, 1), getCoord(curves[2], fbx_time, 2)};
@@ -1750,6 +1817,7 @@ struct AnimationCurveNodeImpl : AnimationCurveNode
 	{
 		const AnimationCurve* curve = nullptr;
 		const Scene::Connection* connection = nullptr;
+		mutable int cursor = 1;
 	};
 
 
@@ -1787,15 +1855,69 @@ struct AnimationLayerImpl : AnimationLayer
 
 	const AnimationCurveNode* getCurveNode(const Object& bone, const char* prop) const override
 	{
-		for (const AnimationCurveNodeImpl* node : curve_nodes)
+		u64 hash = 14695981039346656037ULL;
+		for (const char* c = prop; *c; ++c) hash = hashChar(hash, *c);
+
+		auto iter = curve_node_index.find(NodeKey{bone.id, hash});
+		if (iter != curve_node_index.end() && iter->second->bone == &bone && iter->second->bone_link_property == prop)
+		{
+			return iter->second;
+		}
+
+		// hash collision, fall back to scanning
+		if (iter != curve_node_index.end())
 		{
-			if (node->bone_link_property == prop && node->bone == &bone) return node;
+			for (const AnimationCurveNodeImpl* node : curve_nodes)
+			{
+				if (node->bone_link_property == prop && node->bone == &bone) return node;
+			}
 		}
 		return nullptr;
 	}
 
 
+	// called once all connections are resolved
+	void buildCurveNodeIndex()
+	{
+		curve_node_index.clear();
+		curve_node_index.reserve(curve_nodes.size());
+		for (const AnimationCurveNodeImpl* node : curve_nodes)
+		{
+			if (!node->bone) continue;
+
+			u64 hash = 14695981039346656037ULL;
+			for (const u8* c = node->bone_link_property.begin; c != node->bone_link_property.end; ++c) hash = hashChar(hash, (char)*c);
+
+			// keep the first node like the linear lookup did
+			curve_node_index.emplace(NodeKey{node->bone->id, hash}, node);
+		}
+	}
+
+
+	struct NodeKey
+	{
+		u64 bone_id;
+		u64 property_hash;
+
+		bool operator==(const NodeKey& rhs) const { return bone_id == rhs.bone_id && property_hash == rhs.property_hash; }
+	};
+
+
+	struct NodeKeyHash
+	{
+		size_t operator()(const NodeKey& key) const { return (size_t)(key.bone_id * 31 + key.property_hash); }
+	};
+
+
+	static u64 hashChar(u64 hash, char c)
+	{
+		// FNV-1a
+		return (hash ^ (u8)c) * 1099511628211ULL;
+	}
+
+
 	std::vector<AnimationCurveNodeImpl*> curve_nodes;
+	std::unordered_map<NodeKey, const AnimationCurveNodeImpl*, NodeKeyHash> curve_node_index;
 };
 
 void parseVideo(Scene& scene, const Element& element, Allocator& allocator)
@@ -2765,26 +2887,35 @@ bool ShapeImpl::postprocess(GeometryImpl* geom, Allocator& allocator)
 	allocator.vec3_tmp2.clear(); // old normals
 	allocator.int_tmp.clear(); // old indices
 	if (!parseDoubleVecData(*vertices_element->first_property, &allocator.vec3_tmp, &allocator.tmp)) return true;
-	if (!parseDoubleVecData(*normals_element->first_property, &allocator.vec3_tmp2, &allocator.tmp)) return true;
+	if (normals_element && normals_element->first_property)
+	{
+		if (!parseDoubleVecData(*normals_element->first_property, &allocator.vec3_tmp2, &allocator.tmp)) return true;
+	}
 	if (!parseBinaryArray(*indexes_element->first_property, &allocator.int_tmp)) return true;
 
-	if (allocator.vec3_tmp.size() != allocator.int_tmp.size() || allocator.vec3_tmp2.size() != allocator.int_tmp.size()) return false;
+	if (allocator.vec3_tmp.size() != allocator.int_tmp.size()) return false;
+	if (!allocator.vec3_tmp2.empty() && allocator.vec3_tmp2.size() != allocator.int_tmp.size()) return false;
 
-	vertices = geom->vertices;
-	normals = geom->normals;
+	// deltas stay sparse, a shape usually moves a small part of the geometry
+	indices.reserve(allocator.int_tmp.size());
+	vertex_deltas.reserve(allocator.int_tmp.size());
+	normal_deltas.reserve(allocator.int_tmp.size());
 
-	Vec3* vr = &allocator.vec3_tmp[0];
-	Vec3* nr = &allocator.vec3_tmp2[0];
-	int* ir = &allocator.int_tmp[0];
+	const Vec3 zero = {0, 0, 0};
+	Vec3* vr = allocator.vec3_tmp.empty() ? nullptr : &allocator.vec3_tmp[0];
+	Vec3* nr = allocator.vec3_tmp2.empty() ? nullptr : &allocator.vec3_tmp2[0];
+	int* ir = allocator.int_tmp.empty() ? nullptr : &allocator.int_tmp[0];
 	for (int i = 0, c = (int)allocator.int_tmp.size(); i < c; ++i)
 	{
 		int old_idx = ir[i];
+		if (old_idx < 0 || old_idx >= (int)geom->to_new_vertices.size()) continue;
 		GeometryImpl::NewVertex* n = &geom->to_new_vertices[old_idx];
 		if (n->index == -1) continue; // skip vertices which aren't indexed.
 		while (n)
 		{
-			vertices[n->index] = vertices[n->index] + vr[i];
-			normals[n->index] = normals[n->index] + nr[i];
+			indices.push_back(n->index);
+			vertex_deltas.push_back(vr[i]);
+			normal_deltas.push_back(nr ? nr[i] : zero);
 			n = n->next;
 		}
 	}
@@ -3156,6 +3287,7 @@ static bool parseObjects(const Element& root, Scene* scene, u64 flags, Allocator
 	}
 
 	if (!parse_geom_jobs.empty()) {
+		StageTimer timer(&LoadStatistics::geometry_time, &LoadStatistics::geometry_cpu_time);
 		(*job_processor)([](void* ptr){
 			ParseGeometryJob* job = (ParseGeometryJob*)ptr;
 			job->is_error = parseGeometry(*job->element, job->triangulate, job->geom).isError();
@@ -3350,6 +3482,15 @@ static bool parseObjects(const Element& root, Scene* scene, u64 flags, Allocator
 		}
 	}
 
+	for (auto iter : scene->m_object_map)
+	{
+		Object* obj = iter.second.object;
+		if (obj && obj->getType() == Object::Type::ANIMATION_LAYER)
+		{
+			((AnimationLayerImpl*)obj)->buildCurveNodeIndex();
+		}
+	}
+
 	if (!ignore_geometry) {
 		for (auto iter : scene->m_object_map)
 		{
@@ -3587,17 +3728,38 @@ Object* Object::getParent() const
 }
 
 
-IScene* load(const u8* data, int size, u64 flags, JobProcessor job_processor, void* job_user_ptr)
+IScene* load(const u8* data, int size, u64 flags, JobProcessor job_processor, void* job_user_ptr, ThreadCpuTimeFunction thread_cpu_time)
 {
 	std::unique_ptr<Scene> scene(new Scene());
-	scene->m_data.resize(size);
-	memcpy(&scene->m_data[0], data, size);
+
+	struct StatisticsScope
+	{
+		StatisticsScope(Scene& scene, ThreadCpuTimeFunction thread_cpu_time)
+		{
+			s_statistics = &scene.m_statistics;
+			s_thread_cpu_time = thread_cpu_time;
+		}
+		~StatisticsScope()
+		{
+			s_statistics = nullptr;
+			s_thread_cpu_time = nullptr;
+		}
+	} statistics_scope(*scene, thread_cpu_time);
+
+	const u8* scene_data = data;
+	if (!(flags & (u64)LoadFlags::NO_DATA_COPY))
+	{
+		scene->m_data.resize(size);
+		memcpy(&scene->m_data[0], data, size);
+		scene_data = &scene->m_data[0];
+	}
 	u32 version;
 
 	const bool is_binary = size >= 18 && strncmp((const char*)data, "Kaydara FBX Binary", 18) == 0;
 	OptionalError<Element*> root(nullptr);
 	if (is_binary) {
-		root = tokenize(&scene->m_data[0], size, version, scene->m_allocator);
+		StageTimer timer(&LoadStatistics::tokenize_time, &LoadStatistics::tokenize_cpu_time);
+		root = tokenize(scene_data, size, version, scene->m_allocator);
 		if (version < 6200)
 		{
 			Error::s_message = "Unsupported FBX file format version. Minimum supported version is 6.2";
@@ -3610,7 +3772,8 @@ IScene* load(const u8* data, int size, u64 flags, JobProcessor job_processor, vo
 		}
 	}
 	else {
-		root = tokenizeText(&scene->m_data[0], size, scene->m_allocator);
+		StageTimer timer(&LoadStatistics::tokenize_time, &LoadStatistics::tokenize_cpu_time);
+		root = tokenizeText(scene_data, size, scene->m_allocator);
 		if (root.isError()) return nullptr;
 	}
 
@@ -3618,10 +3781,20 @@ IScene* load(const u8* data, int size, u64 flags, JobProcessor job_processor, vo
 	assert(scene->m_root_element);
 
 	// if (parseTemplates(*root.getValue()).isError()) return nullptr;
-	if (!parseConnections(*root.getValue(), scene.get())) return nullptr;
-	if (!parseTakes(scene.get())) return nullptr;
-	if (!parseObjects(*root.getValue(), scene.get(), flags, scene->m_allocator, job_processor, job_user_ptr)) return nullptr;
+	{
+		StageTimer timer(&LoadStatistics::connections_time, &LoadStatistics::connections_cpu_time);
+		if (!parseConnections(*root.getValue(), scene.get())) return nullptr;
+	}
+	{
+		StageTimer timer(&LoadStatistics::takes_time, &LoadStatistics::takes_cpu_time);
+		if (!parseTakes(scene.get())) return nullptr;
+	}
+	{
+		StageTimer timer(&LoadStatistics::objects_time, &LoadStatistics::objects_cpu_time);
+		if (!parseObjects(*root.getValue(), scene.get(), flags, scene->m_allocator, job_processor, job_user_ptr)) return nullptr;
+	}
 	parseGlobalSettings(*root.getValue(), scene.get());
+	scene->m_statistics.arena_bytes = scene->m_allocator.getSize();
 
 	return scene.release();
 }
@@ -25,6 +25,8 @@ enum class LoadFlags : u64 {
 	TRIANGULATE = 1 << 0,
 	IGNORE_GEOMETRY = 1 << 1,
 	IGNORE_BLEND_SHAPES = 1 << 2,
+	// data passed to load() is referenced instead of copied, it must outlive the scene and all DataViews taken from it
+	NO_DATA_COPY = 1 << 3,
 };
 
 
@@ -366,10 +368,11 @@ struct Shape : Object
 
 	Shape(const Scene& _scene, const IElement& _element);
 
-	virtual const Vec3* getVertices() const = 0;
-	virtual int getVertexCount() const = 0;
-
-	virtual const Vec3* getNormals() const = 0;
+	// Only vertices changed by the shape are stored, as indices into Geometry vertices with offsets
+	virtual int getIndexCount() const = 0;
+	virtual const int* getIndices() const = 0;
+	virtual const Vec3* getVertexDeltas() const = 0;
+	virtual const Vec3* getNormalDeltas() const = 0;
 };
 
 
@@ -501,6 +504,28 @@ struct GlobalSettings
 };
 
 
+// Time in seconds and sizes of the stages of load(). Work of a job processor on other threads is not counted
+struct LoadStatistics
+{
+	double tokenize_time = 0;
+	double connections_time = 0;
+	double takes_time = 0;
+	double objects_time = 0; // includes geometry_time
+	double geometry_time = 0;
+	double inflate_time = 0; // part of the other stages, arrays are inflated when they are parsed
+	// processor time of the same stages, of the loading thread, zero unless load() was given thread_cpu_time
+	double tokenize_cpu_time = 0;
+	double connections_cpu_time = 0;
+	double takes_cpu_time = 0;
+	double objects_cpu_time = 0;
+	double geometry_cpu_time = 0;
+	double inflate_cpu_time = 0;
+	u64 compressed_bytes = 0;
+	u64 inflated_bytes = 0;
+	u64 arena_bytes = 0; // pages of the object allocator
+};
+
+
 struct IScene
 {
 	virtual void destroy() = 0;
@@ -520,13 +545,20 @@ struct IScene
 	virtual int getEmbeddedDataCount() const = 0;
 	virtual DataView getEmbeddedData(int index) const = 0;
 	virtual DataView getEmbeddedFilename(int index) const = 0;
+	virtual const LoadStatistics& getLoadStatistics() const = 0;
 
 protected:
 	virtual ~IScene() {}
 };
 
 
-IScene* load(const u8* data, int size, u64 flags, JobProcessor job_processor = nullptr, void* job_user_ptr = nullptr);
+// Processor time in seconds of the calling thread, supplied by the application for the load statistics
+using ThreadCpuTimeFunction = double (*)();
+
+
+IScene* load(const u8* data, int size, u64 flags, JobProcessor job_processor = nullptr, void* job_user_ptr = nullptr,
+	ThreadCpuTimeFunction thread_cpu_time = nullptr);
+// Error of the last failed load on the calling thread
 const char* getError();
 double fbxTimeToSeconds(i64 value);
 i64 secondsToFbxTime(double value);
@@ -0,0 +1,74 @@
+#ifdef GL_ES
+precision mediump int;
+precision highp float;
+#endif
+
+uniform mat4 view_projection_matrix;
+uniform mat4 source_matrix;
+
+// see BakedAnimation, a row per frame, three texels with matrix rows per joint
+uniform sampler2D palette_texture;
+uniform vec2 palette_texel_size;
+uniform float sample_rate;
+uniform float duration;
+uniform float last_frame;
+uniform float time;
+
+attribute vec3 a_position;
+attribute vec3 a_normal;
+attribute vec2 a_texcoord;
+
+attribute vec4 a_joint_weights;
+attribute vec4 a_joint_indices;
+
+attribute mat4 a_instance_matrix;
+attribute vec2 a_instance_time; // time offset, speed
+
+varying vec3 v_position;
+varying vec3 v_normal;
+varying vec2 v_texcoord;
+
+vec4 fetch_row(const float texel, const float frame)
+{
+    return texture2D(palette_texture, vec2((texel + 0.5) * palette_texel_size.x, (frame + 0.5) * palette_texel_size.y));
+}
+
+vec3 transform_by_joint(const float joint, const float frame, const vec4 position)
+{
+    float texel = joint * 3.0;
+    return vec3(dot(fetch_row(texel, frame), position),
+                dot(fetch_row(texel + 1.0, frame), position),
+                dot(fetch_row(texel + 2.0, frame), position));
+}
+
+vec3 skin(const float frame, const vec4 position)
+{
+    vec3 result = transform_by_joint(a_joint_indices[0], frame, position) * a_joint_weights[0];
+    result     += transform_by_joint(a_joint_indices[1], frame, position) * a_joint_weights[1];
+    result     += transform_by_joint(a_joint_indices[2], frame, position) * a_joint_weights[2];
+    result     += transform_by_joint(a_joint_indices[3], frame, position) * a_joint_weights[3];
+    return result;
+}
+
+void main()
+{
+    float frame = 0.0;
+    if (duration > 0.0)
+    {
+        frame = mod(time * a_instance_time.y + a_instance_time.x, duration) * sample_rate;
+    }
+
+    float frame0 = floor(frame);
+    float frame1 = min(frame0 + 1.0, last_frame);
+
+    vec4 position = vec4(a_position, 1.0);
+    vec3 skinned_position = mix(skin(frame0, position), skin(frame1, position), frame - frame0);
+
+    mat4 model_projection_matrix = view_projection_matrix * a_instance_matrix * source_matrix;
+
+    gl_Position = model_projection_matrix * vec4(skinned_position, 1.0);
+
+    v_position = gl_Position.xyz;
+    v_normal = vec3(model_projection_matrix * vec4(a_normal, 0.0));
+    v_texcoord = a_texcoord;
+}
@@ -15,12 +15,57 @@ attribute vec4 a_joint_indices;
 const int MAX_JOINTS = 100; // do not use more than 50 to avoid problems on some mobile devices https://www.gitmemory.com/issue/mgsx-dev/gdx-gltf/7/562368545
 uniform mat4 joints[MAX_JOINTS];
 
+#ifdef MORPH_TARGETS
+const int MAX_MORPH_TARGETS_PER_VERTEX = 64; // ModelData::MaxMorphTargetsPerVertex
+
+// see ModelData, two texels per entry: position delta with the target index and normal delta
+uniform sampler2D morph_texture;
+uniform vec2 morph_texture_size;
+uniform sampler2D morph_weights;
+uniform float morph_weights_size;
+
+attribute vec2 a_morph_range; // first entry, entry count
+
+vec4 fetch_morph_texel(const float texel)
+{
+    float row = floor(texel / morph_texture_size.x);
+    float column = texel - row * morph_texture_size.x;
+    return texture2D(morph_texture, vec2((column + 0.5) / morph_texture_size.x, (row + 0.5) / morph_texture_size.y));
+}
+
+void apply_morph_targets(inout vec3 position, inout vec3 normal)
+{
+    for (int i = 0; i < MAX_MORPH_TARGETS_PER_VERTEX; ++i)
+    {
+        if (float(i) >= a_morph_range.y)
+        {
+            break;
+        }
+
+        float texel = (a_morph_range.x + float(i)) * 2.0;
+        vec4 position_delta = fetch_morph_texel(texel);
+        float weight = texture2D(morph_weights, vec2((position_delta.w + 0.5) / morph_weights_size, 0.5)).r;
+        if (weight != 0.0)
+        {
+            position += position_delta.xyz * weight;
+            normal += fetch_morph_texel(texel + 1.0).xyz * weight;
+        }
+    }
+}
+#endif
+
 varying vec3 v_position;
 varying vec3 v_normal;
 varying vec2 v_texcoord;
 
 void main()
 {
+    vec3 position = a_position;
+    vec3 normal = a_normal;
+#ifdef MORPH_TARGETS
+    apply_morph_targets(position, normal);
+#endif
+
     v_texcoord = a_texcoord;
 
     mat4 skinningMatrix = joints[int(a_joint_indices[0])] * a_joint_weights[0];
@@ -28,11 +73,11 @@ void main()
     skinningMatrix     += joints[int(a_joint_indices[2])] * a_joint_weights[2];
     skinningMatrix     += joints[int(a_joint_indices[3])] * a_joint_weights[3];
 
-    vec4 skinned_position = skinningMatrix * vec4(a_position, 1.0);
+    vec4 skinned_position = skinningMatrix * vec4(position, 1.0);
 
     gl_Position = model_projection_matrix * skinned_position;
 
     v_position = gl_Position.xyz;
-    v_normal = vec3(model_projection_matrix * vec4(a_normal, 0.0));
+    v_normal = vec3(model_projection_matrix * vec4(normal, 0.0));
     v_texcoord = a_texcoord;
 }
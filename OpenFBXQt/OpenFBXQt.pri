@@ -1,30 +1,72 @@
-QT += opengl
+QT += gui concurrent
+
+# OpenGL classes of QtGui moved to QtOpenGL in Qt 6, the Qt 5 module would also pull in QtWidgets
+greaterThan(QT_MAJOR_VERSION, 5): QT += opengl
 
 INCLUDEPATH += $$PWD
 
 SOURCES += \
         $$PWD/OpenFBX/src/miniz.c \
         $$PWD/OpenFBX/src/ofbx.cpp \
+        $$PWD/animation.cpp \
+        $$PWD/animationbinding.cpp \
+        $$PWD/animationcrowd.cpp \
+        $$PWD/animationplayer.cpp \
         $$PWD/armature.cpp \
-        $$PWD/basescenewidget.cpp \
+        $$PWD/bakedanimation.cpp \
+        $$PWD/framestatistics.cpp \
+        $$PWD/instancedmodel.cpp \
         $$PWD/joint.cpp \
         $$PWD/loader.cpp \
+        $$PWD/loadtask.cpp \
         $$PWD/material.cpp \
         $$PWD/model.cpp \
-        $$PWD/scene.cpp
+        $$PWD/modelcache.cpp \
+        $$PWD/pose.cpp \
+        $$PWD/residencymanager.cpp \
+        $$PWD/scene.cpp \
+        $$PWD/sceneupdater.cpp \
+        $$PWD/texturecache.cpp \
+        $$PWD/uploadqueue.cpp
 
 HEADERS += \
         $$PWD/OpenFBX/src/miniz.h \
         $$PWD/OpenFBX/src/ofbx.h \
+        $$PWD/alignedbuffer.h \
+        $$PWD/animation.h \
+        $$PWD/animationbinding.h \
+        $$PWD/animationcrowd.h \
+        $$PWD/animationplayer.h \
         $$PWD/armature.h \
-        $$PWD/basescenewidget.h \
+        $$PWD/bakedanimation.h \
         $$PWD/datastorage.h \
+        $$PWD/framestatistics.h \
+        $$PWD/instancedmodel.h \
         $$PWD/joint.h \
         $$PWD/loader.h \
+        $$PWD/loadtask.h \
         $$PWD/material.h \
+        $$PWD/memoryreport.h \
         $$PWD/model.h \
+        $$PWD/modelcache.h \
         $$PWD/openfbxqt.h \
-        $$PWD/scene.h
+        $$PWD/pose.h \
+        $$PWD/residencymanager.h \
+        $$PWD/scene.h \
+        $$PWD/sceneupdater.h \
+        $$PWD/simd.h \
+        $$PWD/simdmatrix.h \
+        $$PWD/texturecache.h \
+        $$PWD/triplebuffer.h \
+        $$PWD/uploadqueue.h
 
 RESOURCES += \
     $$PWD/OpenFBXQt-resources.qrc
+
+# BaseSceneWidget is built for applications with widgets only, headless tools do not link QtWidgets
+contains(QT, widgets) {
+    greaterThan(QT_MAJOR_VERSION, 5): QT += openglwidgets
+
+    SOURCES += $$PWD/basescenewidget.cpp
+    HEADERS += $$PWD/basescenewidget.h
+}
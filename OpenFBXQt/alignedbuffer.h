@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QtGlobal>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace ofbxqt
+{
+
+// Zero-initialized array of trivially copyable values aligned to the cache line
+template <typename T>
+class AlignedBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "AlignedBuffer supports only trivially copyable types");
+
+public:
+    static const int Alignment = 64;
+
+    AlignedBuffer() {}
+
+    explicit AlignedBuffer(const int count)
+    {
+        resize(count);
+    }
+
+    AlignedBuffer(const AlignedBuffer& other)
+    {
+        *this = other;
+    }
+
+    AlignedBuffer& operator=(const AlignedBuffer& other)
+    {
+        if (this != &other)
+        {
+            resize(other.count);
+            if (count > 0)
+            {
+                std::memcpy(values, other.values, count * sizeof(T));
+            }
+        }
+
+        return *this;
+    }
+
+    ~AlignedBuffer()
+    {
+        qFreeAligned(values);
+    }
+
+    // Contents are not preserved
+    void resize(const int count_)
+    {
+        if (count_ == count)
+        {
+            fill(T());
+            return;
+        }
+
+        qFreeAligned(values);
+        values = nullptr;
+        count = std::max(count_, 0);
+
+        if (count > 0)
+        {
+            values = static_cast<T*>(qMallocAligned(count * sizeof(T), Alignment));
+            fill(T());
+        }
+    }
+
+    void fill(const T& value)
+    {
+        std::fill(values, values + count, value);
+    }
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+
+    T* data() { return values; }
+    const T* data() const { return values; }
+
+    T& operator[](const int index) { return values[index]; }
+    const T& operator[](const int index) const { return values[index]; }
+
+private:
+    T* values = nullptr;
+    int count = 0;
+};
+
+}
@@ -0,0 +1,683 @@
+#include "animation.h"
+#include "armature.h"
+#include "model.h"
+#include "simd.h"
+#include <QtMath>
+#include <QVarLengthArray>
+#include <algorithm>
+
+namespace ofbxqt
+{
+
+// Longest gap between kept keys, bounds the cost of keyframe reduction
+static const int MaxKeyGap = 64;
+
+static const float SmallestThreeRange = float(M_SQRT1_2);
+
+static quint16 quantize(const float value, const float min, const float extent)
+{
+    if (extent <= 0)
+    {
+        return 0;
+    }
+
+    return quint16(qBound(0, qRound((value - min) / extent * 65535.0f), 65535));
+}
+
+static float dequantize(const quint16 value, const float min, const float extent)
+{
+    return min + value * (extent / 65535.0f);
+}
+
+static void quantize(const QVector3D& value, const QVector3D& min, const QVector3D& extent, quint16* out)
+{
+    out[0] = quantize(value.x(), min.x(), extent.x());
+    out[1] = quantize(value.y(), min.y(), extent.y());
+    out[2] = quantize(value.z(), min.z(), extent.z());
+}
+
+static QVector3D dequantize(const quint16* values, const QVector3D& min, const QVector3D& extent)
+{
+    return QVector3D(
+                dequantize(values[0], min.x(), extent.x()),
+                dequantize(values[1], min.y(), extent.y()),
+                dequantize(values[2], min.z(), extent.z()));
+}
+
+// Stores the three smallest components in 15 bits each, the index of the largest one
+// goes to the high bits of the first two values
+static void encodeQuaternion(const QQuaternion& rotation, quint16* out)
+{
+    const float components[4] = { rotation.x(), rotation.y(), rotation.z(), rotation.scalar() };
+
+    int largest = 0;
+    for (int i = 1; i < 4; ++i)
+    {
+        if (qAbs(components[i]) > qAbs(components[largest]))
+        {
+            largest = i;
+        }
+    }
+
+    const float sign = components[largest] < 0 ? -1.0f : 1.0f;
+
+    int j = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            const float normalized = (components[i] * sign / SmallestThreeRange + 1.0f) * 0.5f;
+            out[j++] = quint16(qBound(0, qRound(normalized * 32767.0f), 32767));
+        }
+    }
+
+    out[0] |= quint16((largest >> 1) << 15);
+    out[1] |= quint16((largest & 1) << 15);
+}
+
+static QQuaternion decodeQuaternion(const quint16* values)
+{
+    const int largest = ((values[0] >> 15) << 1) | (values[1] >> 15);
+
+    float components[4];
+    float sum = 0;
+    int j = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            const float component = ((values[j++] & 0x7FFF) / 32767.0f * 2.0f - 1.0f) * SmallestThreeRange;
+            components[i] = component;
+            sum += component * component;
+        }
+    }
+
+    components[largest] = std::sqrt(qMax(0.0f, 1.0f - sum));
+
+    return QQuaternion(components[3], components[0], components[1], components[2]);
+}
+
+static QQuaternion nlerp(const QQuaternion& a, const QQuaternion& b, const float t)
+{
+    const QQuaternion aligned = QQuaternion::dotProduct(a, b) < 0 ? -b : b;
+    return (a * (1.0f - t) + aligned * t).normalized();
+}
+
+// Keeps the first frame, the last frame and every frame needed so that linear interpolation
+// between kept frames stays within the tolerance. isWithinTolerance(from, to, frame) checks one frame
+template<typename Predicate>
+static QVector<int> reduceKeys(const int frameCount, const Predicate& isWithinTolerance)
+{
+    QVector<int> kept;
+    kept.append(0);
+
+    bool constant = true;
+    for (int frame = 1; frame < frameCount; ++frame)
+    {
+        if (!isWithinTolerance(0, 0, frame))
+        {
+            constant = false;
+            break;
+        }
+    }
+
+    if (constant)
+    {
+        return kept;
+    }
+
+    int from = 0;
+    while (from < frameCount - 1)
+    {
+        int to = from + 1;
+        while (to + 1 < frameCount && to + 1 - from <= MaxKeyGap)
+        {
+            bool fits = true;
+            for (int frame = from + 1; frame <= to; ++frame)
+            {
+                if (!isWithinTolerance(from, to + 1, frame))
+                {
+                    fits = false;
+                    break;
+                }
+            }
+
+            if (!fits)
+            {
+                break;
+            }
+
+            ++to;
+        }
+
+        kept.append(to);
+        from = to;
+    }
+
+    return kept;
+}
+
+static float getFactor(const int from, const int to, const int frame)
+{
+    return from == to ? 0.0f : float(frame - from) / float(to - from);
+}
+
+// Finds the kept keys around the frame and returns the interpolation factor between them
+static float findKeys(const quint32* frames, const int count, const double frame, int& key1, int& key2)
+{
+    if (count <= 1)
+    {
+        key1 = key2 = 0;
+        return 0;
+    }
+
+    const quint32* upper = std::upper_bound(frames, frames + count, quint32(frame));
+    key2 = qBound(1, int(upper - frames), count - 1);
+    key1 = key2 - 1;
+
+    return float(qBound(0.0, (frame - frames[key1]) / double(frames[key2] - frames[key1]), 1.0));
+}
+
+AnimationClip::AnimationClip(const QString& name_, const double frameRate_, const int frameCount_, const QVector<AnimationTrack>& tracks_)
+    : name(name_)
+    , frameRate(frameRate_)
+    , frameCount(frameCount_)
+    , trackStride((tracks_.count() + simd::Width - 1) / simd::Width * simd::Width)
+    , tracks(tracks_)
+    , keys(frameCount_ * ChannelCount * trackStride)
+    , pose(ChannelCount * trackStride)
+{
+
+}
+
+double AnimationClip::getDuration() const
+{
+    if (frameCount <= 1 || frameRate <= 0)
+    {
+        return 0;
+    }
+
+    return (frameCount - 1) / frameRate;
+}
+
+void AnimationClip::sample(const double time, float* pose_) const
+{
+    if (frameCount <= 0)
+    {
+        return;
+    }
+
+    const double frame = qBound(0.0, time * frameRate, double(frameCount - 1));
+
+    if (compressed)
+    {
+        sampleCompressed(frame, pose_);
+        simd::normalizeQuaternions(
+                    pose_ + RotationX * trackStride,
+                    pose_ + RotationY * trackStride,
+                    pose_ + RotationZ * trackStride,
+                    pose_ + RotationW * trackStride,
+                    trackStride);
+        return;
+    }
+
+    const int frame1 = qFloor(frame);
+    const int frame2 = qMin(frame1 + 1, frameCount - 1);
+    const int poseSize = getPoseSize();
+
+    // Keys of neighbouring frames are in the same hemisphere, so all channels are interpolated
+    // at once and the rotations are renormalized afterwards (nlerp)
+    simd::lerpArrays(keys.data() + frame1 * poseSize, keys.data() + frame2 * poseSize, float(frame - frame1), pose_, poseSize);
+    simd::normalizeQuaternions(
+                pose_ + RotationX * trackStride,
+                pose_ + RotationY * trackStride,
+                pose_ + RotationZ * trackStride,
+                pose_ + RotationW * trackStride,
+                trackStride);
+}
+
+Transform AnimationClip::getTransform(const float* pose_, const int stride, const int index)
+{
+    Transform transform;
+
+    transform.setTRS(QVector3D(
+                         pose_[TranslationX * stride + index],
+                         pose_[TranslationY * stride + index],
+                         pose_[TranslationZ * stride + index]),
+                     QQuaternion(
+                         pose_[RotationW * stride + index],
+                         pose_[RotationX * stride + index],
+                         pose_[RotationY * stride + index],
+                         pose_[RotationZ * stride + index]),
+                     QVector3D(
+                         pose_[ScaleX * stride + index],
+                         pose_[ScaleY * stride + index],
+                         pose_[ScaleZ * stride + index]));
+
+    return transform;
+}
+
+QMatrix4x4 AnimationClip::getMatrix(const float* pose_, const int stride, const int index)
+{
+    const float translation[3] = {
+        pose_[TranslationX * stride + index],
+        pose_[TranslationY * stride + index],
+        pose_[TranslationZ * stride + index] };
+
+    const float rotation[4] = {
+        pose_[RotationX * stride + index],
+        pose_[RotationY * stride + index],
+        pose_[RotationZ * stride + index],
+        pose_[RotationW * stride + index] };
+
+    const float scale[3] = {
+        pose_[ScaleX * stride + index],
+        pose_[ScaleY * stride + index],
+        pose_[ScaleZ * stride + index] };
+
+    QMatrix4x4 matrix;
+    simd::composeTRS(translation, rotation, scale, matrix.data());
+    return matrix;
+}
+
+bool AnimationClip::apply(const double time) const
+{
+    QVarLengthArray<std::shared_ptr<Armature>, 4> lockedArmatures;
+    bool needSample = false;
+    bool skipped = false;
+
+    for (const std::weak_ptr<Armature>& weakArmature : armatures)
+    {
+        const std::shared_ptr<Armature> armature = weakArmature.lock();
+        lockedArmatures.append(armature);
+        needSample |= armature && !armature->lodSkipUpdate;
+        skipped |= armature && armature->lodSkipUpdate;
+    }
+
+    for (int i = 0; i < tracks.count() && !needSample; ++i)
+    {
+        needSample = trackArmatures.value(i, -1) == -1;
+    }
+
+    // every armature waits for its next evaluation
+    if (!needSample)
+    {
+        return !skipped;
+    }
+
+    sample(time, pose.data());
+
+    for (int i = 0; i < tracks.count(); ++i)
+    {
+        const AnimationTrack& track = tracks[i];
+
+        const std::shared_ptr<Joint> joint = track.joint.lock();
+        if (joint)
+        {
+            const int armatureIndex = trackArmatures.value(i, -1);
+            const Armature* armature = armatureIndex == -1 ? nullptr : lockedArmatures[armatureIndex].get();
+            if (armature && (armature->lodSkipUpdate || armature->jointHeights.value(joint->index) < armature->lodFrozenLeafLevels))
+            {
+                continue;
+            }
+
+            joint->setTransform(getTransform(pose.data(), i));
+            continue;
+        }
+
+        const std::shared_ptr<Model> model = track.model.lock();
+        if (model)
+        {
+            model->setTransform(getTransform(pose.data(), i));
+        }
+    }
+
+    for (const std::shared_ptr<Armature>& armature : lockedArmatures)
+    {
+        if (armature && !armature->lodSkipUpdate)
+        {
+            armature->update();
+        }
+    }
+
+    return !skipped;
+}
+
+void AnimationClip::setKey(const int frame, const int trackIndex, const QVector3D& translation, const QQuaternion& rotation_, const QVector3D& scale)
+{
+    if (compressed)
+    {
+        qCritical() << Q_FUNC_INFO << "clip" << name << "is already compressed";
+        return;
+    }
+
+    if (frame < 0 || frame >= frameCount || trackIndex < 0 || trackIndex >= tracks.count())
+    {
+        qCritical() << Q_FUNC_INFO << "key out of bound, frame" << frame << ", track" << trackIndex;
+        return;
+    }
+
+    float* key = keys.data() + frame * getPoseSize() + trackIndex;
+
+    QQuaternion rotation = rotation_;
+    if (frame > 0)
+    {
+        // keep neighbour keys in the same hemisphere for interpolation
+        const float* previous = key - getPoseSize();
+        const QQuaternion previousRotation(
+                    previous[RotationW * trackStride],
+                    previous[RotationX * trackStride],
+                    previous[RotationY * trackStride],
+                    previous[RotationZ * trackStride]);
+
+        if (QQuaternion::dotProduct(previousRotation, rotation) < 0)
+        {
+            rotation = -rotation;
+        }
+    }
+
+    key[TranslationX * trackStride] = translation.x();
+    key[TranslationY * trackStride] = translation.y();
+    key[TranslationZ * trackStride] = translation.z();
+
+    key[RotationX * trackStride] = rotation.x();
+    key[RotationY * trackStride] = rotation.y();
+    key[RotationZ * trackStride] = rotation.z();
+    key[RotationW * trackStride] = rotation.scalar();
+
+    key[ScaleX * trackStride] = scale.x();
+    key[ScaleY * trackStride] = scale.y();
+    key[ScaleZ * trackStride] = scale.z();
+}
+
+qint64 AnimationClip::getKeysSize() const
+{
+    if (compressed)
+    {
+        return compressedTracks.count() * qint64(sizeof(CompressedTrack))
+                + keyFrames.count() * qint64(sizeof(quint32))
+                + keyValues.count() * qint64(sizeof(quint16))
+                + rawKeyValues.count() * qint64(sizeof(float));
+    }
+
+    return keys.size() * qint64(sizeof(float));
+}
+
+int AnimationClip::compress(const float translationTolerance, const float rotationTolerance, const float scaleTolerance)
+{
+    if (compressed || frameCount <= 0)
+    {
+        return 0;
+    }
+
+    const int poseSize = getPoseSize();
+    const float translationToleranceSquared = translationTolerance * translationTolerance;
+    const float scaleToleranceSquared = scaleTolerance * scaleTolerance;
+    const float minRotationDot = qCos(qDegreesToRadians(rotationTolerance) * 0.5f);
+
+    QVector<QVector3D> translations(frameCount);
+    QVector<QQuaternion> rotations(frameCount);
+    QVector<QVector3D> scales(frameCount);
+
+    QVector<QVector3D> decodedTranslations(frameCount);
+    QVector<QQuaternion> decodedRotations(frameCount);
+    QVector<QVector3D> decodedScales(frameCount);
+
+    QVector<quint16> translationValues(frameCount * 3);
+    QVector<quint16> rotationValues(frameCount * 3);
+    QVector<quint16> scaleValues(frameCount * 3);
+
+    compressedTracks.resize(tracks.count());
+    int rawChannelCount = 0;
+
+    // Appends the kept keys of one channel
+    auto appendKeys = [this](CompressedChannel& channel, const QVector<int>& kept, const QVector<quint16>& values)
+    {
+        channel.firstKey = keyFrames.count();
+        channel.keyCount = kept.count();
+        channel.firstValue = keyValues.count();
+
+        for (const int frame : kept)
+        {
+            keyFrames.append(quint32(frame));
+            keyValues.append(values[frame * 3 + 0]);
+            keyValues.append(values[frame * 3 + 1]);
+            keyValues.append(values[frame * 3 + 2]);
+        }
+    };
+
+    auto appendRawVectors = [this](CompressedChannel& channel, const QVector<int>& kept, const QVector<QVector3D>& values)
+    {
+        channel.firstKey = keyFrames.count();
+        channel.keyCount = kept.count();
+        channel.firstValue = rawKeyValues.count();
+        channel.raw = true;
+
+        for (const int frame : kept)
+        {
+            keyFrames.append(quint32(frame));
+            rawKeyValues.append(values[frame].x());
+            rawKeyValues.append(values[frame].y());
+            rawKeyValues.append(values[frame].z());
+        }
+    };
+
+    auto appendRawRotations = [this](CompressedChannel& channel, const QVector<int>& kept, const QVector<QQuaternion>& values)
+    {
+        channel.firstKey = keyFrames.count();
+        channel.keyCount = kept.count();
+        channel.firstValue = rawKeyValues.count();
+        channel.raw = true;
+
+        for (const int frame : kept)
+        {
+            keyFrames.append(quint32(frame));
+            rawKeyValues.append(values[frame].x());
+            rawKeyValues.append(values[frame].y());
+            rawKeyValues.append(values[frame].z());
+            rawKeyValues.append(values[frame].scalar());
+        }
+    };
+
+    for (int i = 0; i < tracks.count(); ++i)
+    {
+        CompressedTrack& track = compressedTracks[i];
+
+        QVector3D translationMax;
+        QVector3D scaleMax;
+
+        for (int frame = 0; frame < frameCount; ++frame)
+        {
+            const float* key = keys.data() + frame * poseSize + i;
+
+            translations[frame] = QVector3D(key[TranslationX * trackStride], key[TranslationY * trackStride], key[TranslationZ * trackStride]);
+            rotations[frame] = QQuaternion(key[RotationW * trackStride], key[RotationX * trackStride], key[RotationY * trackStride], key[RotationZ * trackStride]).normalized();
+            scales[frame] = QVector3D(key[ScaleX * trackStride], key[ScaleY * trackStride], key[ScaleZ * trackStride]);
+
+            if (frame == 0)
+            {
+                track.translationMin = translationMax = translations[frame];
+                track.scaleMin = scaleMax = scales[frame];
+            }
+            else
+            {
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    track.translationMin[axis] = qMin(track.translationMin[axis], translations[frame][axis]);
+                    translationMax[axis] = qMax(translationMax[axis], translations[frame][axis]);
+                    track.scaleMin[axis] = qMin(track.scaleMin[axis], scales[frame][axis]);
+                    scaleMax[axis] = qMax(scaleMax[axis], scales[frame][axis]);
+                }
+            }
+        }
+
+        track.translationExtent = translationMax - track.translationMin;
+        track.scaleExtent = scaleMax - track.scaleMin;
+
+        // Reduction compares against decoded keys, so the tolerance covers the quantization error too.
+        // Kept keys are not checked by the reduction, a channel that does not fit 16 bits over its extent
+        // (e.g. long root motion) keeps its keys at full precision
+        bool translationQuantized = true;
+        bool rotationQuantized = true;
+        bool scaleQuantized = true;
+
+        for (int frame = 0; frame < frameCount; ++frame)
+        {
+            quantize(translations[frame], track.translationMin, track.translationExtent, translationValues.data() + frame * 3);
+            decodedTranslations[frame] = dequantize(translationValues.data() + frame * 3, track.translationMin, track.translationExtent);
+
+            encodeQuaternion(rotations[frame], rotationValues.data() + frame * 3);
+            decodedRotations[frame] = decodeQuaternion(rotationValues.data() + frame * 3);
+
+            quantize(scales[frame], track.scaleMin, track.scaleExtent, scaleValues.data() + frame * 3);
+            decodedScales[frame] = dequantize(scaleValues.data() + frame * 3, track.scaleMin, track.scaleExtent);
+
+            translationQuantized &= (decodedTranslations[frame] - translations[frame]).lengthSquared() <= translationToleranceSquared;
+            rotationQuantized &= qAbs(QQuaternion::dotProduct(decodedRotations[frame], rotations[frame])) >= minRotationDot;
+            scaleQuantized &= (decodedScales[frame] - scales[frame]).lengthSquared() <= scaleToleranceSquared;
+        }
+
+        if (!translationQuantized)
+        {
+            decodedTranslations = translations;
+            ++rawChannelCount;
+        }
+
+        if (!rotationQuantized)
+        {
+            decodedRotations = rotations;
+            ++rawChannelCount;
+        }
+
+        if (!scaleQuantized)
+        {
+            decodedScales = scales;
+            ++rawChannelCount;
+        }
+
+        const QVector<int> translationKeys = reduceKeys(frameCount, [&](const int from, const int to, const int frame)
+        {
+            const float t = getFactor(from, to, frame);
+            const QVector3D value = decodedTranslations[from] * (1.0f - t) + decodedTranslations[to] * t;
+            return (value - translations[frame]).lengthSquared() <= translationToleranceSquared;
+        });
+
+        const QVector<int> rotationKeys = reduceKeys(frameCount, [&](const int from, const int to, const int frame)
+        {
+            const QQuaternion value = nlerp(decodedRotations[from], decodedRotations[to], getFactor(from, to, frame));
+            return qAbs(QQuaternion::dotProduct(value, rotations[frame])) >= minRotationDot;
+        });
+
+        const QVector<int> scaleKeys = reduceKeys(frameCount, [&](const int from, const int to, const int frame)
+        {
+            const float t = getFactor(from, to, frame);
+            const QVector3D value = decodedScales[from] * (1.0f - t) + decodedScales[to] * t;
+            return (value - scales[frame]).lengthSquared() <= scaleToleranceSquared;
+        });
+
+        if (translationQuantized)
+        {
+            appendKeys(track.translation, translationKeys, translationValues);
+        }
+        else
+        {
+            appendRawVectors(track.translation, translationKeys, translations);
+        }
+
+        if (rotationQuantized)
+        {
+            appendKeys(track.rotation, rotationKeys, rotationValues);
+        }
+        else
+        {
+            appendRawRotations(track.rotation, rotationKeys, rotations);
+        }
+
+        if (scaleQuantized)
+        {
+            appendKeys(track.scale, scaleKeys, scaleValues);
+        }
+        else
+        {
+            appendRawVectors(track.scale, scaleKeys, scales);
+        }
+    }
+
+    keyFrames.squeeze();
+    keyValues.squeeze();
+    rawKeyValues.squeeze();
+
+    keys.resize(0);
+    compressed = true;
+
+    return rawChannelCount;
+}
+
+void AnimationClip::sampleCompressed(const double frame, float* pose_) const
+{
+    int key1 = 0;
+    int key2 = 0;
+
+    auto sampleVector = [this, &key1, &key2, frame](const CompressedChannel& channel, const QVector3D& min, const QVector3D& extent)
+    {
+        const float t = findKeys(keyFrames.constData() + channel.firstKey, channel.keyCount, frame, key1, key2);
+
+        if (channel.raw)
+        {
+            const float* values = rawKeyValues.constData() + channel.firstValue;
+            return QVector3D(values[key1 * 3], values[key1 * 3 + 1], values[key1 * 3 + 2]) * (1.0f - t) +
+                    QVector3D(values[key2 * 3], values[key2 * 3 + 1], values[key2 * 3 + 2]) * t;
+        }
+
+        const quint16* values = keyValues.constData() + channel.firstValue;
+        return dequantize(values + key1 * 3, min, extent) * (1.0f - t) + dequantize(values + key2 * 3, min, extent) * t;
+    };
+
+    for (int i = 0; i < compressedTracks.count(); ++i)
+    {
+        const CompressedTrack& track = compressedTracks[i];
+
+        const QVector3D translation = sampleVector(track.translation, track.translationMin, track.translationExtent);
+
+        const CompressedChannel& rotationChannel = track.rotation;
+        const float t = findKeys(keyFrames.constData() + rotationChannel.firstKey, rotationChannel.keyCount, frame, key1, key2);
+        QQuaternion rotation1;
+        QQuaternion rotation2;
+        if (rotationChannel.raw)
+        {
+            const float* values = rawKeyValues.constData() + rotationChannel.firstValue;
+            rotation1 = QQuaternion(values[key1 * 4 + 3], values[key1 * 4], values[key1 * 4 + 1], values[key1 * 4 + 2]);
+            rotation2 = QQuaternion(values[key2 * 4 + 3], values[key2 * 4], values[key2 * 4 + 1], values[key2 * 4 + 2]);
+        }
+        else
+        {
+            const quint16* values = keyValues.constData() + rotationChannel.firstValue;
+            rotation1 = decodeQuaternion(values + key1 * 3);
+            rotation2 = decodeQuaternion(values + key2 * 3);
+        }
+
+        if (QQuaternion::dotProduct(rotation1, rotation2) < 0)
+        {
+            rotation2 = -rotation2;
+        }
+        // normalized for all tracks at once by the caller
+        const QQuaternion rotation = rotation1 * (1.0f - t) + rotation2 * t;
+
+        const QVector3D scale = sampleVector(track.scale, track.scaleMin, track.scaleExtent);
+
+        pose_[TranslationX * trackStride + i] = translation.x();
+        pose_[TranslationY * trackStride + i] = translation.y();
+        pose_[TranslationZ * trackStride + i] = translation.z();
+
+        pose_[RotationX * trackStride + i] = rotation.x();
+        pose_[RotationY * trackStride + i] = rotation.y();
+        pose_[RotationZ * trackStride + i] = rotation.z();
+        pose_[RotationW * trackStride + i] = rotation.scalar();
+
+        pose_[ScaleX * trackStride + i] = scale.x();
+        pose_[ScaleY * trackStride + i] = scale.y();
+        pose_[ScaleZ * trackStride + i] = scale.z();
+    }
+}
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "openfbxqt.h"
+#include "alignedbuffer.h"
+#include <QVector>
+#include <memory>
+
+namespace ofbxqt
+{
+
+class Joint;
+class Model;
+class Armature;
+
+struct AnimationTrack
+{
+    // Exactly one of the targets is set
+    std::weak_ptr<Joint> joint;
+    std::weak_ptr<Model> model;
+};
+
+class AnimationClip
+{
+public:
+    friend class Loader;
+    friend class ModelCache;
+
+    // Channels of a pose. Every channel is a contiguous array holding one value per track
+    enum Channel
+    {
+        TranslationX, TranslationY, TranslationZ,
+        RotationX, RotationY, RotationZ, RotationW,
+        ScaleX, ScaleY, ScaleZ,
+        ChannelCount
+    };
+
+    const QString& getName() const { return name; }
+    double getDuration() const;
+    double getFrameRate() const { return frameRate; }
+    int getFrameCount() const { return frameCount; }
+    const QVector<AnimationTrack>& getTracks() const { return tracks; }
+    // Index of the layer in the animation stack of the file
+    int getLayerIndex() const { return layerIndex; }
+
+    // Length of a channel, the track count rounded up to the SIMD width
+    int getTrackStride() const { return trackStride; }
+    // Number of floats in a pose
+    int getPoseSize() const { return ChannelCount * trackStride; }
+
+    // Writes the pose at the given time into a 16-byte aligned buffer of getPoseSize() floats
+    void sample(const double time, float* pose) const;
+    Transform getTransform(const float* pose, const int trackIndex) const { return getTransform(pose, trackStride, trackIndex); }
+    // Translation * rotation * scale of a track, same as getTransform(pose, trackIndex).getResultMatrix()
+    QMatrix4x4 getMatrix(const float* pose, const int trackIndex) const { return getMatrix(pose, trackStride, trackIndex); }
+
+    // Access to any pose in the channel layout, stride is the length of a channel
+    static Transform getTransform(const float* pose, const int stride, const int index);
+    static QMatrix4x4 getMatrix(const float* pose, const int stride, const int index);
+
+    // Returns false if an armature skipped the pose because of the animation level of detail
+    bool apply(const double time) const;
+
+    bool isCompressed() const { return compressed; }
+    // Memory used by keys in bytes
+    qint64 getKeysSize() const;
+
+private:
+    struct CompressedChannel
+    {
+        int firstKey = 0; // in keyFrames
+        int keyCount = 0;
+        int firstValue = 0; // in rawKeyValues if raw, otherwise in keyValues
+        bool raw = false; // floats, three per key or four for rotations
+    };
+
+    // Translations and scales are normalized to the range of the track, rotations are stored as smallest three
+    struct CompressedTrack
+    {
+        QVector3D translationMin;
+        QVector3D translationExtent;
+        QVector3D scaleMin;
+        QVector3D scaleExtent;
+
+        CompressedChannel translation;
+        CompressedChannel rotation;
+        CompressedChannel scale;
+    };
+
+    AnimationClip(const QString& name, const double frameRate, const int frameCount, const QVector<AnimationTrack>& tracks);
+
+    void setKey(const int frame, const int trackIndex, const QVector3D& translation, const QQuaternion& rotation, const QVector3D& scale);
+    // Returns the number of channels kept at full precision because quantization alone exceeds a tolerance
+    int compress(const float translationTolerance, const float rotationTolerance, const float scaleTolerance);
+    void sampleCompressed(const double frame, float* pose) const;
+
+    QString name;
+    double frameRate = 30.0;
+    int frameCount = 0;
+    int layerIndex = 0;
+    int trackStride = 0;
+    QVector<AnimationTrack> tracks;
+    QVector<std::weak_ptr<Armature>> armatures;
+    QVector<int> trackArmatures; // <track index, index in armatures or -1>
+
+    AlignedBuffer<float> keys; // one pose per frame
+    mutable AlignedBuffer<float> pose;
+
+    bool compressed = false;
+    QVector<CompressedTrack> compressedTracks;
+    QVector<quint32> keyFrames;
+    QVector<quint16> keyValues; // three values per key
+    QVector<float> rawKeyValues; // of channels that do not fit the quantization
+};
+
+}
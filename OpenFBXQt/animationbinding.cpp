@@ -0,0 +1,67 @@
+#include "animationbinding.h"
+
+namespace ofbxqt
+{
+
+AnimationBinding::AnimationBinding(std::shared_ptr<AnimationClip> clip_, std::shared_ptr<Armature> armature)
+    : clip(clip_)
+{
+    if (!armature)
+    {
+        qCritical() << Q_FUNC_INFO << "armature is null";
+        return;
+    }
+
+    hierarchyHash = getHierarchyHash(*armature);
+    jointTracks.fill(-1, armature->getAllJoints().count());
+
+    if (!clip)
+    {
+        qCritical() << Q_FUNC_INFO << "clip is null";
+        return;
+    }
+
+    const QVector<AnimationTrack>& tracks = clip->getTracks();
+    for (int i = 0; i < tracks.count(); ++i)
+    {
+        const std::shared_ptr<Joint> joint = tracks[i].joint.lock();
+        if (!joint)
+        {
+            continue;
+        }
+
+        const int jointIndex = armature->jointsByName.value(joint->getName(), -1);
+        if (jointIndex < 0 || jointIndex >= jointTracks.count())
+        {
+            continue;
+        }
+
+        if (jointTracks[jointIndex] == -1)
+        {
+            ++boundJointCount;
+        }
+
+        jointTracks[jointIndex] = i;
+    }
+}
+
+bool AnimationBinding::isCompatible(const Armature& armature) const
+{
+    return armature.getAllJoints().count() == jointTracks.count() && getHierarchyHash(armature) == hierarchyHash;
+}
+
+uint AnimationBinding::getHierarchyHash(const Armature& armature)
+{
+    uint hash = 0;
+
+    const QVector<std::shared_ptr<Joint>>& joints = armature.getAllJoints();
+    for (int i = 0; i < joints.count(); ++i)
+    {
+        hash = hash * 31 + qHash(joints[i]->getName());
+        hash = hash * 31 + uint(armature.parentIndices.value(i, -1) + 1);
+    }
+
+    return hash;
+}
+
+}
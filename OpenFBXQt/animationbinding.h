@@ -0,0 +1,37 @@
+#pragma once
+
+#include "animation.h"
+#include "armature.h"
+
+namespace ofbxqt
+{
+
+// Table of clip tracks for joints of an armature, indexed like Armature::getAllJoints().
+// Joints are matched by name, so a binding is built once and shared by every armature with the same hierarchy
+class AnimationBinding
+{
+public:
+    AnimationBinding(std::shared_ptr<AnimationClip> clip, std::shared_ptr<Armature> armature);
+
+    std::shared_ptr<AnimationClip> getClip() const { return clip; }
+
+    int getJointCount() const { return jointTracks.count(); }
+    int getBoundJointCount() const { return boundJointCount; }
+
+    // Returns -1 if the joint is not animated by the clip
+    int getTrack(const int jointIndex) const { return jointTracks.value(jointIndex, -1); }
+    const QVector<int>& getJointTracks() const { return jointTracks; }
+
+    // True if the armature has the same joints in the same order as the one the binding was built for
+    bool isCompatible(const Armature& armature) const;
+
+    static uint getHierarchyHash(const Armature& armature);
+
+private:
+    std::shared_ptr<AnimationClip> clip;
+    QVector<int> jointTracks;
+    int boundJointCount = 0;
+    uint hierarchyHash = 0;
+};
+
+}
@@ -0,0 +1,256 @@
+#include "animationcrowd.h"
+#include <QtConcurrent>
+#include <cmath>
+
+namespace ofbxqt
+{
+
+static const int ChunkSize = 16; // instances per task
+
+AnimationCrowd::AnimationCrowd(std::shared_ptr<AnimationClip> clip_, std::shared_ptr<Armature> armature_)
+    : clip(clip_)
+    , armature(armature_)
+    , binding(std::make_shared<AnimationBinding>(clip_, armature_))
+{
+    bind();
+}
+
+AnimationCrowd::AnimationCrowd(std::shared_ptr<const AnimationBinding> binding_, std::shared_ptr<Armature> armature_)
+    : clip(binding_ ? binding_->getClip() : nullptr)
+    , armature(armature_)
+    , binding(binding_)
+{
+    bind();
+}
+
+int AnimationCrowd::addInstance(const double time, const double speed)
+{
+    Instance instance;
+    instance.time = time;
+    instance.speed = speed;
+
+    instances.append(instance);
+    needUpdateChunks = true;
+
+    return instances.count() - 1;
+}
+
+void AnimationCrowd::removeInstance(const int index)
+{
+    if (index < 0 || index >= instances.count())
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    instances.remove(index);
+    needUpdateChunks = true;
+}
+
+void AnimationCrowd::clearInstances()
+{
+    instances.clear();
+    needUpdateChunks = true;
+}
+
+void AnimationCrowd::setInstanceTime(const int index, const double time)
+{
+    if (index < 0 || index >= instances.count())
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    instances[index].time = time;
+}
+
+double AnimationCrowd::getInstanceTime(const int index) const
+{
+    if (index < 0 || index >= instances.count())
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return 0;
+    }
+
+    return instances[index].time;
+}
+
+void AnimationCrowd::setInstanceSpeed(const int index, const double speed)
+{
+    if (index < 0 || index >= instances.count())
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    instances[index].speed = speed;
+}
+
+double AnimationCrowd::getInstanceSpeed(const int index) const
+{
+    if (index < 0 || index >= instances.count())
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return 0;
+    }
+
+    return instances[index].speed;
+}
+
+void AnimationCrowd::advance(const double deltaSeconds)
+{
+    if (!clip)
+    {
+        return;
+    }
+
+    const double duration = clip->getDuration();
+
+    for (Instance& instance : instances)
+    {
+        instance.time += deltaSeconds * instance.speed;
+
+        if (duration <= 0)
+        {
+            instance.time = 0;
+        }
+        else if (loop)
+        {
+            instance.time = std::fmod(instance.time, duration);
+            if (instance.time < 0)
+            {
+                instance.time += duration;
+            }
+        }
+        else
+        {
+            instance.time = qBound(0.0, instance.time, duration);
+        }
+    }
+}
+
+void AnimationCrowd::evaluate()
+{
+    if (!clip || !binding)
+    {
+        return;
+    }
+
+    if (needUpdateChunks)
+    {
+        needUpdateChunks = false;
+        updateChunks();
+    }
+
+    if (chunks.count() == 1)
+    {
+        evaluateChunk(chunks[0]);
+    }
+    else if (chunks.count() > 1)
+    {
+        QtConcurrent::blockingMap(chunks, [this](Chunk& chunk) { evaluateChunk(chunk); });
+    }
+}
+
+const QMatrix4x4* AnimationCrowd::getPalette(const int index) const
+{
+    if (index < 0 || index >= instances.count() || (index + 1) * getJointCount() > palettes.count())
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return nullptr;
+    }
+
+    return palettes.constData() + index * getJointCount();
+}
+
+void AnimationCrowd::bind()
+{
+    const std::shared_ptr<Armature> armature_ = armature.lock();
+    if (!armature_)
+    {
+        qCritical() << Q_FUNC_INFO << "armature is null";
+        return;
+    }
+
+    // the template armature may be playing on the update thread, only data fixed since loading is read
+    parentIndices = armature_->parentIndices;
+    sourceMatrices = armature_->sourceMatrices;
+    inverseSourceMatrices = armature_->inverseSourceMatrices;
+    restLocalMatrices = armature_->restLocalMatrices;
+
+    if (!clip || !binding)
+    {
+        qCritical() << Q_FUNC_INFO << "clip is null";
+        binding.reset();
+        return;
+    }
+
+    if (!binding->isCompatible(*armature_))
+    {
+        qCritical() << Q_FUNC_INFO << "binding is not compatible with the armature";
+        binding.reset();
+    }
+}
+
+void AnimationCrowd::updateChunks()
+{
+    palettes.resize(instances.count() * getJointCount());
+
+    const int chunkCount = (instances.count() + ChunkSize - 1) / ChunkSize;
+    chunks.resize(chunkCount);
+
+    for (int i = 0; i < chunkCount; ++i)
+    {
+        Chunk& chunk = chunks[i];
+        chunk.begin = i * ChunkSize;
+        chunk.end = qMin(chunk.begin + ChunkSize, instances.count());
+
+        if (chunk.pose.size() != clip->getPoseSize())
+        {
+            chunk.pose.resize(clip->getPoseSize());
+        }
+    }
+}
+
+void AnimationCrowd::evaluateChunk(Chunk& chunk)
+{
+    const int jointCount = getJointCount();
+    const QVector<int>& jointTracks = binding->getJointTracks();
+    float* pose = chunk.pose.data();
+
+    for (int i = chunk.begin; i < chunk.end; ++i)
+    {
+        clip->sample(instances[i].time, pose);
+
+        QMatrix4x4* palette = palettes.data() + i * jointCount;
+
+        // Joints are sorted so that parents precede children
+        for (int j = 0; j < jointCount; ++j)
+        {
+            const int track = jointTracks[j];
+
+            QMatrix4x4 local;
+            if (track == -1)
+            {
+                local = restLocalMatrices[j];
+            }
+            else
+            {
+                simd::multiply(inverseSourceMatrices[j].constData(), clip->getMatrix(pose, track).constData(), local.data());
+                simd::multiply(local.constData(), sourceMatrices[j].constData(), local.data());
+            }
+
+            const int parentIndex = parentIndices[j];
+            if (parentIndex == -1)
+            {
+                palette[j] = local;
+            }
+            else
+            {
+                simd::multiply(palette[parentIndex].constData(), local.constData(), palette[j].data());
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "animationbinding.h"
+
+namespace ofbxqt
+{
+
+// Evaluates one clip for many instances of the same armature at their own time and speed.
+// Instances are split into chunks which are evaluated in parallel, each instance gets its own palette
+class AnimationCrowd
+{
+public:
+    AnimationCrowd(std::shared_ptr<AnimationClip> clip, std::shared_ptr<Armature> armature);
+    // The binding may come from another armature with the same hierarchy
+    AnimationCrowd(std::shared_ptr<const AnimationBinding> binding, std::shared_ptr<Armature> armature);
+
+    std::shared_ptr<AnimationClip> getClip() const { return clip; }
+    std::shared_ptr<Armature> getArmature() const { return armature.lock(); }
+
+    int addInstance(const double time = 0, const double speed = 1);
+    void removeInstance(const int index);
+    void clearInstances();
+    int getInstanceCount() const { return instances.count(); }
+
+    void setInstanceTime(const int index, const double time);
+    double getInstanceTime(const int index) const;
+
+    void setInstanceSpeed(const int index, const double speed);
+    double getInstanceSpeed(const int index) const;
+
+    void setLoop(const bool loop_) { loop = loop_; }
+    bool isLoop() const { return loop; }
+
+    // Advances the time of every instance
+    void advance(const double deltaSeconds);
+
+    // Samples the clip and writes palettes of all instances
+    void evaluate();
+
+    int getJointCount() const { return parentIndices.count(); }
+    // getJointCount() matrices in the order of Armature::getAllJoints(), same layout as the palette of the armature
+    const QMatrix4x4* getPalette(const int index) const;
+
+private:
+    struct Instance
+    {
+        double time = 0;
+        double speed = 1;
+    };
+
+    struct Chunk
+    {
+        int begin = 0;
+        int end = 0;
+        AlignedBuffer<float> pose;
+    };
+
+    void bind();
+    void updateChunks();
+    void evaluateChunk(Chunk& chunk);
+
+    std::shared_ptr<AnimationClip> clip;
+    std::weak_ptr<Armature> armature;
+
+    bool loop = true;
+    QVector<Instance> instances;
+    QVector<Chunk> chunks;
+    bool needUpdateChunks = true;
+
+    // Copied from the armature on construction
+    QVector<int> parentIndices;
+    QVector<QMatrix4x4> sourceMatrices;
+    QVector<QMatrix4x4> inverseSourceMatrices;
+    QVector<QMatrix4x4> restLocalMatrices; // for joints without a track
+    std::shared_ptr<const AnimationBinding> binding;
+
+    QVector<QMatrix4x4> palettes; // getJointCount() matrices per instance
+};
+
+}
@@ -0,0 +1,108 @@
+#include "animationplayer.h"
+#include <QtMath>
+#include <cmath>
+
+namespace ofbxqt
+{
+
+AnimationPlayer::AnimationPlayer(std::shared_ptr<AnimationClip> clip_, std::function<void()> onNeedUpdateCallback_)
+    : clip(clip_)
+    , onNeedUpdateCallback(onNeedUpdateCallback_)
+{
+    if (!clip)
+    {
+        qCritical() << Q_FUNC_INFO << "clip is null";
+    }
+}
+
+void AnimationPlayer::play()
+{
+    if (clip && !loop && speed >= 0 && time >= clip->getDuration())
+    {
+        time = 0;
+        needApply = true;
+    }
+
+    playing = true;
+    needUpdate();
+}
+
+void AnimationPlayer::pause()
+{
+    playing = false;
+}
+
+void AnimationPlayer::stop()
+{
+    playing = false;
+    seek(0);
+}
+
+void AnimationPlayer::seek(const double time_)
+{
+    const double duration = clip ? clip->getDuration() : 0.0;
+
+    time = qBound(0.0, time_, duration);
+    needApply = true;
+    needUpdate();
+}
+
+void AnimationPlayer::setLoop(const bool loop_)
+{
+    loop = loop_;
+}
+
+void AnimationPlayer::setSpeed(const double speed_)
+{
+    speed = speed_;
+}
+
+void AnimationPlayer::advance(const double deltaSeconds)
+{
+    if (!clip)
+    {
+        return;
+    }
+
+    if (playing)
+    {
+        const double duration = clip->getDuration();
+
+        time += deltaSeconds * speed;
+
+        if (duration <= 0)
+        {
+            time = 0;
+        }
+        else if (loop)
+        {
+            time = std::fmod(time, duration);
+            if (time < 0)
+            {
+                time += duration;
+            }
+        }
+        else if ((speed > 0 && time >= duration) || (speed < 0 && time <= 0))
+        {
+            time = qBound(0.0, time, duration);
+            playing = false;
+        }
+
+        needApply = true;
+    }
+
+    if (needApply)
+    {
+        needApply = !clip->apply(time);
+    }
+}
+
+void AnimationPlayer::needUpdate()
+{
+    if (onNeedUpdateCallback)
+    {
+        onNeedUpdateCallback();
+    }
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "animation.h"
+#include <functional>
+
+namespace ofbxqt
+{
+
+class AnimationPlayer
+{
+public:
+    AnimationPlayer(std::shared_ptr<AnimationClip> clip, std::function<void()> onNeedUpdateCallback = nullptr);
+
+    std::shared_ptr<AnimationClip> getClip() const { return clip; }
+
+    void play();
+    void pause();
+    void stop();
+    bool isPlaying() const { return playing; }
+    // True until every armature of the clip has the current pose
+    bool isApplyPending() const { return needApply; }
+
+    void seek(const double time);
+    double getTime() const { return time; }
+
+    void setLoop(const bool loop);
+    bool isLoop() const { return loop; }
+
+    void setSpeed(const double speed);
+    double getSpeed() const { return speed; }
+
+    // Advances the playback time and writes the sampled pose into the joints and models of the clip
+    void advance(const double deltaSeconds);
+
+private:
+    void needUpdate();
+
+    std::shared_ptr<AnimationClip> clip;
+    std::function<void()> onNeedUpdateCallback = nullptr;
+
+    bool playing = false;
+    bool loop = true;
+    bool needApply = true;
+    double speed = 1.0;
+    double time = 0.0;
+};
+
+}
@@ -1,14 +1,59 @@
 #include "armature.h"
+#include "pose.h"
 
 namespace ofbxqt
 {
 
 void Armature::update()
 {
-    for (const std::shared_ptr<Joint>& joint : qAsConst(topLevelJoints))
+    if (dirtyBegin >= dirtyEnd)
     {
-         update(joint);
+        return;
+    }
+
+    // Parents precede children, so one linear pass over the dirty range is enough.
+    // Joints outside of the range belong to untouched subtrees and are skipped entirely
+    for (int i = dirtyBegin; i < dirtyEnd; ++i)
+    {
+        quint8 flags = dirtyFlags[i];
+
+        const int parentIndex = parentIndices[i];
+        if (parentIndex != -1 && (dirtyFlags[parentIndex] & WorldDirty))
+        {
+            flags |= WorldDirty;
+        }
+
+        if (!flags)
+        {
+            continue;
+        }
+
+        float* local = localMatrices[i].data();
+
+        if (flags & LocalDirty)
+        {
+            simd::multiply(inverseSourceMatrices[i].constData(), allJoints[i]->getTransform().getResultMatrix().constData(), local);
+            simd::multiply(local, sourceMatrices[i].constData(), local);
+        }
+
+        if (parentIndex == -1)
+        {
+            jointsMatrices[i] = localMatrices[i];
+        }
+        else
+        {
+            simd::multiply(jointsMatrices[parentIndex].constData(), local, jointsMatrices[i].data());
+        }
+
+        dirtyFlags[i] = WorldDirty;
     }
+
+    std::fill(dirtyFlags.begin() + dirtyBegin, dirtyFlags.begin() + dirtyEnd, 0);
+
+    dirtyBegin = allJoints.count();
+    dirtyEnd = 0;
+
+    lodPaletteChanged = true;
 }
 
 std::shared_ptr<Joint> Armature::getJointByName(const QString &name)
@@ -28,22 +73,158 @@ std::shared_ptr<Joint> Armature::getJointByName(const QString &name)
     return allJoints[index];
 }
 
-void Armature::update(std::shared_ptr<Joint> joint, const QMatrix4x4 &parentMatrix)
+void Armature::buildEvaluationOrder()
+{
+    QVector<std::shared_ptr<Joint>> sortedJoints;
+    sortedJoints.reserve(allJoints.count());
+
+    QVector<int> sortedParents;
+    sortedParents.reserve(allJoints.count());
+
+    QVector<QPair<std::shared_ptr<Joint>, int>> stack; // <joint, parent index in sorted array>
+    for (int i = topLevelJoints.count() - 1; i >= 0; --i)
+    {
+        stack.append(QPair<std::shared_ptr<Joint>, int>(topLevelJoints[i], -1));
+    }
+
+    while (!stack.isEmpty())
+    {
+        const QPair<std::shared_ptr<Joint>, int> item = stack.takeLast();
+        if (!item.first)
+        {
+            qWarning() << Q_FUNC_INFO << "joint is null";
+            continue;
+        }
+
+        const int sortedIndex = sortedJoints.count();
+        sortedJoints.append(item.first);
+        sortedParents.append(item.second);
+
+        const QVector<std::shared_ptr<Joint>>& children = item.first->children;
+        for (int i = children.count() - 1; i >= 0; --i)
+        {
+            stack.append(QPair<std::shared_ptr<Joint>, int>(children[i], sortedIndex));
+        }
+    }
+
+    if (sortedJoints.count() != allJoints.count())
+    {
+        qCritical() << Q_FUNC_INFO << "joint hierarchy is inconsistent, sorted" << sortedJoints.count() << "of" << allJoints.count() << "joints";
+    }
+
+    QVector<int> newIndices(allJoints.count(), -1); // <old index, new index>
+    for (int i = 0; i < sortedJoints.count(); ++i)
+    {
+        const std::shared_ptr<Joint>& joint = sortedJoints[i];
+        if ((int)joint->index < newIndices.count())
+        {
+            newIndices[joint->index] = i;
+        }
+
+        joint->index = i;
+    }
+
+    for (auto it = jointsByName.begin(); it != jointsByName.end(); ++it)
+    {
+        *it = newIndices.value(*it, -1);
+    }
+
+    allJoints = sortedJoints;
+    parentIndices = sortedParents;
+
+    const int count = allJoints.count();
+
+    subtreeEnds.fill(0, count);
+    for (int i = count - 1; i >= 0; --i)
+    {
+        if (subtreeEnds[i] < i + 1)
+        {
+            subtreeEnds[i] = i + 1;
+        }
+
+        const int parentIndex = parentIndices[i];
+        if (parentIndex != -1 && subtreeEnds[parentIndex] < subtreeEnds[i])
+        {
+            subtreeEnds[parentIndex] = subtreeEnds[i];
+        }
+    }
+
+    jointHeights.fill(0, count);
+    for (int i = count - 1; i >= 0; --i)
+    {
+        const int parentIndex = parentIndices[i];
+        if (parentIndex != -1 && jointHeights[parentIndex] < jointHeights[i] + 1)
+        {
+            jointHeights[parentIndex] = quint8(qMin(jointHeights[i] + 1, 255));
+        }
+    }
+
+    sourceMatrices.resize(count);
+    inverseSourceMatrices.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        sourceMatrices[i] = allJoints[i]->sourceMatrix;
+        inverseSourceMatrices[i] = allJoints[i]->sourceMatrix.inverted();
+    }
+
+    restLocalMatrices.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        restLocalMatrices[i] = simd::multiply(simd::multiply(inverseSourceMatrices[i], allJoints[i]->getTransform().getResultMatrix()), sourceMatrices[i]);
+    }
+
+    localMatrices.fill(QMatrix4x4(), count);
+    jointsMatrices.fill(QMatrix4x4(), count);
+    dirtyFlags.fill(0, count);
+
+    setAllJointsDirty();
+}
+
+void Armature::setJointDirty(const int index)
 {
-    if (!joint)
+    if (index < 0 || index >= dirtyFlags.count())
     {
-        qWarning() << Q_FUNC_INFO << "joint is null";
+        qCritical() << Q_FUNC_INFO << "index out of bound";
         return;
     }
 
-    const QMatrix4x4 matrix = parentMatrix * joint->sourceMatrix.inverted() * joint->getTransform().getResultMatrix() * joint->sourceMatrix;
+    dirtyFlags[index] |= LocalDirty;
+    dirtyBegin = qMin(dirtyBegin, index);
+    dirtyEnd = qMax(dirtyEnd, subtreeEnds[index]);
+}
+
+void Armature::setAllJointsDirty()
+{
+    std::fill(dirtyFlags.begin(), dirtyFlags.end(), (quint8)LocalDirty);
+    dirtyBegin = 0;
+    dirtyEnd = dirtyFlags.count();
+}
 
-    jointsMatrices[joint->index] = matrix;
+void Armature::setPose(const Pose& pose)
+{
+    const int count = allJoints.count();
+    if (pose.getJointCount() != count)
+    {
+        qCritical() << Q_FUNC_INFO << "pose does not match armature";
+        return;
+    }
 
-    for (const std::shared_ptr<Joint> &child : qAsConst(joint->children))
+    // Local matrices are written directly, so joint transforms are left as they are.
+    // Joints set through Joint::setTransform afterwards override the pose
+    const float* values = pose.getChannel(AnimationClip::TranslationX);
+    for (int i = 0; i < count; ++i)
     {
-        update(child, matrix);
+        localMatrices[i] = AnimationClip::getMatrix(values, pose.getStride(), i);
     }
+
+    simd::multiplyArrays(inverseSourceMatrices.constData(), localMatrices.constData(), localMatrices.data(), count);
+    simd::multiplyArrays(localMatrices.constData(), sourceMatrices.constData(), localMatrices.data(), count);
+
+    std::fill(dirtyFlags.begin(), dirtyFlags.end(), (quint8)WorldDirty);
+    dirtyBegin = 0;
+    dirtyEnd = count;
+
+    update();
 }
 
 }
@@ -6,25 +6,80 @@ namespace ofbxqt
 {
 
 class Model;
+class Pose;
 
 class Armature
 {
 public:
     friend class Loader;
+    friend class ModelCache;
     friend class Model;
+    friend class Joint;
+    friend class Scene;
+    friend class AnimationClip;
+    friend class AnimationBinding;
+    friend class AnimationCrowd;
+    friend class Pose;
+    friend class PoseMask;
 
     std::weak_ptr<Model> model;
 
+    // A palette matrix split for interpolation by the animation level of detail
+    struct LodTransform
+    {
+        QVector3D translation;
+        QQuaternion rotation;
+        QVector3D scale;
+    };
+
     void update();
 
     const QVector<std::shared_ptr<Joint>>& getTopLevelJoints() const { return topLevelJoints; }
     const QVector<std::shared_ptr<Joint>>& getAllJoints() const { return allJoints; }
+    const QVector<QMatrix4x4>& getJointsMatrices() const { return jointsMatrices; }
     std::shared_ptr<Joint> getJointByName(const QString& name);
 
 private:
-    void update(std::shared_ptr<Joint>, const QMatrix4x4& parentMatrix = QMatrix4x4());
+    enum DirtyFlag : quint8
+    {
+        LocalDirty = 1 << 0,
+        WorldDirty = 1 << 1,
+    };
+
+    void buildEvaluationOrder();
+    void setJointDirty(const int index);
+    void setAllJointsDirty();
+    void setPose(const Pose& pose);
+
+    // Flat evaluation data. All arrays are indexed by Joint::index, joints are sorted in depth-first order,
+    // so a parent always precedes its children and every subtree occupies the range [index, subtreeEnds[index])
+    QVector<int> parentIndices;
+    QVector<int> subtreeEnds;
+    QVector<QMatrix4x4> sourceMatrices;
+    QVector<QMatrix4x4> inverseSourceMatrices;
+    QVector<QMatrix4x4> localMatrices;
+    QVector<QMatrix4x4> restLocalMatrices; // of the joint transforms when the order was built, before any animation
+    QVector<quint8> dirtyFlags;
+    int dirtyBegin = 0;
+    int dirtyEnd = 0;
+
+    QVector<QMatrix4x4> jointsMatrices; // world matrices of joints, passed to shader
+    QVector<quint8> jointHeights; // levels below the joint, 0 for leaves
+
+    // Animation level of detail, assigned by Scene. Clips do not touch the armature between evaluations
+    // and leave joints with a height below lodFrozenLeafLevels as they are
+    int lodUpdateInterval = 1;
+    int lodFrozenLeafLevels = 0;
+    int lodPhase = 0; // spreads evaluations of armatures with the same interval over frames
+    int lodStep = 0; // frames since the last evaluation
+    bool lodSkipUpdate = false;
+    bool lodPaletteChanged = false; // set by update(), the next evaluation starts a new interpolation
+    bool lodOffscreen = false; // the palette is not interpolated
+    // Decomposed once per evaluation: the shown palette at the evaluation and the new jointsMatrices
+    QVector<LodTransform> lodFrom;
+    QVector<LodTransform> lodTo;
+    QVector<QMatrix4x4> lodShownMatrices; // interpolated from lodFrom to lodTo
 
-    QVector<QMatrix4x4> jointsMatrices;
     QHash<QString, int> jointsByName; // <name, index>
     QVector<std::shared_ptr<Joint>> topLevelJoints;
     QVector<std::shared_ptr<Joint>> allJoints;
@@ -0,0 +1,113 @@
+#include "bakedanimation.h"
+#include "animationcrowd.h"
+#include <cmath>
+
+namespace ofbxqt
+{
+
+BakedAnimation::BakedAnimation(std::shared_ptr<AnimationClip> clip_, std::shared_ptr<Armature> armature, const double sampleRate_)
+    : clip(clip_)
+{
+    if (!clip)
+    {
+        qCritical() << Q_FUNC_INFO << "clip is null";
+        return;
+    }
+
+    if (!armature)
+    {
+        qCritical() << Q_FUNC_INFO << "armature is null";
+        return;
+    }
+
+    sampleRate = sampleRate_ > 0 ? sampleRate_ : clip->getFrameRate();
+    if (sampleRate <= 0)
+    {
+        qCritical() << Q_FUNC_INFO << "sample rate is" << sampleRate;
+        return;
+    }
+
+    duration = clip->getDuration();
+    frameCount = int(std::ceil(duration * sampleRate)) + 1;
+
+    // every frame is an instance of the crowd, so the palettes are evaluated in parallel
+    AnimationCrowd crowd(clip, armature);
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        crowd.addInstance(qMin(frame / sampleRate, duration));
+    }
+
+    crowd.evaluate();
+
+    jointCount = crowd.getJointCount();
+    texels.resize(frameCount * getTextureWidth() * 4);
+
+    float* texel = texels.data();
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        const QMatrix4x4* palette = crowd.getPalette(frame);
+        if (!palette)
+        {
+            return;
+        }
+
+        for (int joint = 0; joint < jointCount; ++joint)
+        {
+            const QMatrix4x4& matrix = palette[joint];
+            for (int row = 0; row < TexelsPerJoint; ++row)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    *texel++ = matrix(row, column);
+                }
+            }
+        }
+    }
+}
+
+void BakedAnimation::initializeGL()
+{
+    if (initializedGL)
+    {
+        return;
+    }
+
+    initializedGL = true;
+
+    initializeOpenGLFunctions();
+
+    if (texels.isEmpty())
+    {
+        qCritical() << Q_FUNC_INFO << "nothing baked";
+        return;
+    }
+
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    if (getTextureWidth() > maxTextureSize || getTextureHeight() > maxTextureSize)
+    {
+        qCritical() << Q_FUNC_INFO << "texture size" << getTextureWidth() << "x" << getTextureHeight() << "exceeds" << maxTextureSize << ", use a lower sample rate";
+        return;
+    }
+
+    texture.reset(new QOpenGLTexture(QOpenGLTexture::Target2D));
+    texture->setFormat(QOpenGLTexture::RGBA32F);
+    texture->setSize(getTextureWidth(), getTextureHeight());
+    texture->setMipLevels(1);
+    texture->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+    texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+    texture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::Float32);
+
+    if (!texture->isStorageAllocated())
+    {
+        qCritical() << Q_FUNC_INFO << "failed to allocate float texture";
+        texture.reset();
+        return;
+    }
+
+    texture->setData(QOpenGLTexture::RGBA, QOpenGLTexture::Float32, texels.constData());
+
+    texels.clear();
+}
+
+}
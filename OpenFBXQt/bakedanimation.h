@@ -0,0 +1,46 @@
+#pragma once
+
+#include "animationbinding.h"
+#include <QOpenGLFunctions>
+#include <QOpenGLTexture>
+
+namespace ofbxqt
+{
+
+// Palettes of a clip sampled at a fixed rate and stored in a float texture, so skinning can be done
+// entirely on the GPU. A row holds one frame, a joint takes three texels with the first three rows of its matrix
+class BakedAnimation : protected QOpenGLFunctions
+{
+public:
+    friend class InstancedModel;
+    friend class Scene;
+
+    // sampleRate <= 0 means the frame rate of the clip
+    BakedAnimation(std::shared_ptr<AnimationClip> clip, std::shared_ptr<Armature> armature, const double sampleRate = 0);
+
+    std::shared_ptr<AnimationClip> getClip() const { return clip; }
+    int getJointCount() const { return jointCount; }
+    int getFrameCount() const { return frameCount; }
+    double getSampleRate() const { return sampleRate; }
+    double getDuration() const { return duration; }
+
+    int getTextureWidth() const { return jointCount * TexelsPerJoint; }
+    int getTextureHeight() const { return frameCount; }
+
+    void initializeGL();
+
+private:
+    static const int TexelsPerJoint = 3;
+
+    std::shared_ptr<AnimationClip> clip;
+    int jointCount = 0;
+    int frameCount = 0;
+    double sampleRate = 0;
+    double duration = 0;
+
+    bool initializedGL = false;
+    QVector<float> texels; // released after upload
+    std::unique_ptr<QOpenGLTexture> texture;
+};
+
+}
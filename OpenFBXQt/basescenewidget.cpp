@@ -1,4 +1,5 @@
 #include "basescenewidget.h"
+#include <QPainter>
 
 namespace ofbxqt
 {
@@ -26,6 +27,46 @@ void BaseSceneWidget::resizeGL(int width, int height)
 void BaseSceneWidget::paintGL()
 {
     scene.paintGL();
+
+    if (statisticsOverlayEnabled)
+    {
+        paintStatisticsOverlay();
+    }
+}
+
+void BaseSceneWidget::setStatisticsOverlayEnabled(const bool enabled)
+{
+    statisticsOverlayEnabled = enabled;
+    scene.setGpuTimingEnabled(enabled);
+    update();
+}
+
+void BaseSceneWidget::paintStatisticsOverlay()
+{
+    const FrameStatistics& statistics = scene.getFrameStatistics();
+
+    QStringList lines;
+    lines.append(QString("CPU %1 ms, GPU %2").arg(statistics.cpuMs, 0, 'f', 2)
+                 .arg(statistics.gpuMs >= 0 ? QString::number(statistics.gpuMs, 'f', 2) + " ms" : QString("n/a")));
+    lines.append(QString("Frame interval %1 ms").arg(statistics.frameIntervalMs, 0, 'f', 1));
+    lines.append(QString("Draw calls %1, triangles %2").arg(statistics.drawCalls).arg(statistics.triangles));
+    lines.append(QString("Binds: shaders %1, textures %2, buffers %3").arg(statistics.shaderBinds).arg(statistics.textureBinds).arg(statistics.bufferBinds));
+    lines.append(QString("Uniforms %1, palettes %2 KB, texture uploads %3").arg(statistics.uniformUploads)
+                 .arg(statistics.paletteBytes / 1024.0, 0, 'f', 1).arg(statistics.textureUploads));
+    lines.append(QString("Culled models %1").arg(statistics.culledModels));
+
+    const QString text = lines.join("\n");
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+
+    const int margin = 6;
+    const QRect textRect = painter.fontMetrics().boundingRect(QRect(), Qt::AlignLeft | Qt::AlignTop, text);
+    const QRect rect(2 * margin, 2 * margin, textRect.width(), textRect.height());
+
+    painter.fillRect(QRect(margin, margin, rect.width() + 2 * margin, rect.height() + 2 * margin), QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(rect, Qt::AlignLeft | Qt::AlignTop, text);
 }
 
 }
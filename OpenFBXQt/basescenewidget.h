@@ -15,6 +15,10 @@ public:
 
     explicit BaseSceneWidget(QWidget *parent = nullptr);
 
+    // Draws counters and timings of the last frame over the scene, GPU timing of the scene is switched with it
+    void setStatisticsOverlayEnabled(const bool enabled);
+    bool isStatisticsOverlayEnabled() const { return statisticsOverlayEnabled; }
+
 signals:
 
 protected:
@@ -22,6 +26,10 @@ protected:
     void resizeGL(int width, int height) override;
     void paintGL() override;
 
+private:
+    void paintStatisticsOverlay();
+
+    bool statisticsOverlayEnabled = false;
 };
 
 }
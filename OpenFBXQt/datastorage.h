@@ -6,8 +6,11 @@
 #include <QOpenGLBuffer>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
+#include <QMutex>
 #include <map>
 
+class QFile;
+
 namespace ofbxqt
 {
 
@@ -22,6 +25,12 @@ struct VertexAttributeInfo
     int tupleSize = 0;
 };
 
+struct MorphTarget
+{
+    QString name;
+    float defaultWeight = 0;
+};
+
 struct ModelData
 {
     QString name;
@@ -31,23 +40,75 @@ struct ModelData
 
     QMatrix4x4 sourceMatrix;
 
+    // Box of vertex positions in the bind pose, before sourceMatrix
+    QVector3D boundsMin;
+    QVector3D boundsMax;
+
     const GLenum drawElementsMode = GL_TRIANGLES;
 
     const GLenum indexType = GL_UNSIGNED_INT;
     const int indexStride = (1) * sizeof(GLuint);
     int indexCount = 0;
-    mutable QByteArray indexData;
+    mutable QByteArray indexData; // released after upload
+    mutable int indexBytesUploaded = 0;
 
     QVector<VertexAttributeInfo> vertexAttributes;
     int vertexStride = 0;
     int vertexCount = 0;
-    mutable QByteArray vertexData;
+    mutable QByteArray vertexData; // released after upload
+    mutable int vertexBytesUploaded = 0;
+
+    mutable std::shared_ptr<QFile> mappedFile; // entry of the model cache referenced by vertexData and indexData
+
+    // Morph target deltas grouped by vertex, a_morph_range holds the first entry and the entry count of a vertex.
+    // An entry is two texels: position delta with the target index and normal delta
+    static const int MorphTextureWidth = 2048;
+    static const int MaxMorphTargetsPerVertex = 64;
+    QVector<MorphTarget> morphTargets;
+    int morphEntryCount = 0;
+    mutable QVector<float> morphData; // released after upload
+    mutable std::shared_ptr<QOpenGLTexture> morphTexture;
 
     mutable QOpenGLBuffer vertexBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
     mutable QOpenGLBuffer indexBuffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
 
     mutable QOpenGLShaderProgram shader; // TODO: move to shaders storage
 
+    // Residency: with a video memory budget the CPU copies are kept, so released buffers can be uploaded again
+    mutable bool keepCpuData = false;
+    mutable bool residencyTracked = false;
+    mutable quint64 lastUsedFrame = 0;
+
+    bool isResident() const
+    {
+        return vertexBuffer.isCreated() && vertexBytesUploaded >= vertexCount * vertexStride
+                && indexBuffer.isCreated() && indexBytesUploaded >= indexCount * indexStride
+                && (morphTargets.isEmpty() || morphTexture);
+    }
+
+    qint64 getGpuSize() const
+    {
+        const qint64 morphSize = morphTexture ? qint64(morphTexture->width()) * morphTexture->height() * 4 * int(sizeof(float)) : 0;
+        return qint64(vertexCount) * vertexStride + qint64(indexCount) * indexStride + morphSize;
+    }
+
+    // Returns false when there are no CPU copies to upload the data again
+    bool releaseGL() const
+    {
+        if (!keepCpuData)
+        {
+            return false;
+        }
+
+        vertexBuffer.destroy();
+        indexBuffer.destroy();
+        morphTexture.reset();
+        vertexBytesUploaded = 0;
+        indexBytesUploaded = 0;
+
+        return true;
+    }
+
     enum class AxisDirection { XPlus, XMinus, YPlus, YMinus, ZPlus, ZMinus };
     static QString axisDirectionToString(const AxisDirection ad)
     {
@@ -72,6 +133,8 @@ struct ModelData
     AxisDirection forwardDirection = AxisDirection::ZMinus;
 };
 
+// Textures shared between the files opened with it, owned by a Scene or by a Loader. Loaders of the same
+// storage may run concurrently
 class DataStorage
 {
 public:
@@ -79,21 +142,22 @@ public:
     friend class Loader;
     friend class Scene;
 
-    static DataStorage& getInstance()
-    {
-        static DataStorage instance;
+    DataStorage(){}
 
-        return instance;
+    // Drops the references kept for sharing between files, models keep the data they use
+    void clear()
+    {
+        QMutexLocker locker(&mutex);
+        textures.clear();
     }
 
 private:
-    DataStorage(){}
     DataStorage(const DataStorage&) = delete;
     DataStorage(DataStorage&&) = delete;
 
-    // TODO: all data storages
-    std::map<QString, std::shared_ptr<TextureInfo>> textures; // <file name, texture>
-    std::vector<std::shared_ptr<ModelData>> data; // move to scene, make non static
+    QMutex mutex; // loaders run concurrently
+
+    std::map<QString, std::shared_ptr<TextureInfo>> textures; // <file name or hash of embedded content, texture>
 };
 
 }
@@ -0,0 +1,89 @@
+#include "framestatistics.h"
+
+namespace ofbxqt
+{
+
+bool GpuFrameTimer::initializeGL()
+{
+    destroyGL();
+
+    for (Query& query : queries)
+    {
+        query.query = std::make_shared<QOpenGLTimerQuery>();
+        if (!query.query->create())
+        {
+            destroyGL();
+            return false;
+        }
+    }
+
+    supported = true;
+
+    return true;
+}
+
+void GpuFrameTimer::destroyGL()
+{
+    for (Query& query : queries)
+    {
+        if (query.query)
+        {
+            query.query->destroy();
+        }
+
+        query = Query();
+    }
+
+    next = 0;
+    active = false;
+    supported = false;
+    lastMilliseconds = -1;
+}
+
+void GpuFrameTimer::begin()
+{
+    if (!supported)
+    {
+        return;
+    }
+
+    collect();
+
+    // waiting for a result would stall the pipeline
+    if (queries[next].pending)
+    {
+        return;
+    }
+
+    queries[next].query->begin();
+    active = true;
+}
+
+void GpuFrameTimer::end()
+{
+    if (!active)
+    {
+        return;
+    }
+
+    queries[next].query->end();
+    queries[next].pending = true;
+    next = (next + 1) % QueryCount;
+    active = false;
+}
+
+void GpuFrameTimer::collect()
+{
+    // from the oldest, so the latest result is kept
+    for (int i = 0; i < QueryCount; ++i)
+    {
+        Query& query = queries[(next + i) % QueryCount];
+        if (query.pending && query.query->isResultAvailable())
+        {
+            lastMilliseconds = query.query->waitForResult() / 1000000.0;
+            query.pending = false;
+        }
+    }
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTimerQuery>
+#include <memory>
+
+namespace ofbxqt
+{
+
+// Counters and timings of a drawn frame
+struct FrameStatistics
+{
+    int drawCalls = 0;
+    qint64 triangles = 0; // of all instances
+    int shaderBinds = 0;
+    int textureBinds = 0;
+    int bufferBinds = 0;
+    int uniformUploads = 0; // calls, an array counts once
+    qint64 paletteBytes = 0; // joint matrices uploaded as uniforms
+    int textureUploads = 0; // texture updates while drawing, such as morph weights
+    int culledModels = 0;
+
+    double cpuMs = 0; // of Scene::paintGL()
+    double frameIntervalMs = 0; // since the previous frame started
+    double gpuMs = -1; // of a frame a few frames earlier, negative without timer queries or before the first result
+};
+
+// Set a uniform of a shader and count the call, so the counters follow the actual calls
+template<typename T>
+inline void setUniform(QOpenGLShaderProgram& shader, const char* name, const T& value, FrameStatistics& statistics)
+{
+    shader.setUniformValue(name, value);
+    ++statistics.uniformUploads;
+}
+
+template<typename T>
+inline void setUniformArray(QOpenGLShaderProgram& shader, const char* name, const T* values, const int count, FrameStatistics& statistics)
+{
+    shader.setUniformValueArray(name, values, count);
+    ++statistics.uniformUploads;
+}
+
+// Measures the GPU time of frames with timer queries. Results arrive a few frames later, so several queries
+// are in flight and a frame is skipped when all of them are still pending. Used from the OpenGL thread only
+class GpuFrameTimer
+{
+public:
+    // Returns false if the context has no timer queries
+    bool initializeGL();
+    void destroyGL();
+    bool isSupported() const { return supported; }
+
+    void begin();
+    void end();
+
+    // Of the latest frame with a result, negative before the first one
+    double getLastMilliseconds() const { return lastMilliseconds; }
+
+private:
+    void collect();
+
+    static const int QueryCount = 4;
+
+    struct Query
+    {
+        std::shared_ptr<QOpenGLTimerQuery> query;
+        bool pending = false;
+    };
+
+    Query queries[QueryCount];
+    int next = 0; // the oldest query, used for the next frame
+    bool active = false;
+    bool supported = false;
+    double lastMilliseconds = -1;
+};
+
+}
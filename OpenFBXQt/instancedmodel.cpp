@@ -0,0 +1,339 @@
+#include "instancedmodel.h"
+#include <algorithm>
+
+namespace ofbxqt
+{
+
+InstancedModel::InstancedModel(std::shared_ptr<Model> model_, std::shared_ptr<BakedAnimation> animation_)
+    : model(model_)
+    , animation(animation_)
+{
+    if (!model)
+    {
+        qCritical() << Q_FUNC_INFO << "model is null";
+    }
+
+    if (!animation)
+    {
+        qCritical() << Q_FUNC_INFO << "animation is null";
+    }
+}
+
+int InstancedModel::addInstance(const QMatrix4x4& worldMatrix, const double timeOffset, const double speed)
+{
+    const int index = getInstanceCount();
+
+    instanceData.resize((index + 1) * InstanceSize);
+    setInstanceMatrix(index, worldMatrix);
+    setInstanceTimeOffset(index, timeOffset);
+    setInstanceSpeed(index, speed);
+
+    return index;
+}
+
+void InstancedModel::removeInstance(const int index)
+{
+    if (!isValidIndex(index))
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    instanceData.remove(index * InstanceSize, InstanceSize);
+    ++revision;
+}
+
+void InstancedModel::clearInstances()
+{
+    instanceData.clear();
+    ++revision;
+}
+
+void InstancedModel::setInstanceMatrix(const int index, const QMatrix4x4& worldMatrix)
+{
+    if (!isValidIndex(index))
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    std::copy(worldMatrix.constData(), worldMatrix.constData() + 16, instanceData.data() + index * InstanceSize);
+    ++revision;
+}
+
+void InstancedModel::setInstanceTimeOffset(const int index, const double timeOffset)
+{
+    if (!isValidIndex(index))
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    instanceData[index * InstanceSize + 16] = float(timeOffset);
+    ++revision;
+}
+
+void InstancedModel::setInstanceSpeed(const int index, const double speed)
+{
+    if (!isValidIndex(index))
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    instanceData[index * InstanceSize + 17] = float(speed);
+    ++revision;
+}
+
+void InstancedModel::advance(const double deltaSeconds)
+{
+    if (playing)
+    {
+        time += deltaSeconds;
+    }
+}
+
+bool InstancedModel::isValidIndex(const int index) const
+{
+    return index >= 0 && index < getInstanceCount();
+}
+
+void InstancedModel::initializeGL()
+{
+    if (initializedGL)
+    {
+        return;
+    }
+
+    initializedGL = true;
+
+    initializeOpenGLFunctions();
+
+    if (!model || !model->data)
+    {
+        qCritical() << Q_FUNC_INFO << "model is null";
+        return;
+    }
+
+    if (!model->data->armature)
+    {
+        qCritical() << Q_FUNC_INFO << "model has no armature";
+        return;
+    }
+
+    if (!animation)
+    {
+        qCritical() << Q_FUNC_INFO << "animation is null";
+        return;
+    }
+
+    model->initializeGL();
+    animation->initializeGL();
+
+    if (!instanceBuffer.create())
+    {
+        qCritical() << Q_FUNC_INFO << "failed to create instance buffer";
+    }
+
+    instanceBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+
+    QString fshaderFileName;
+    if (model->material && model->material->diffuseTexture)
+    {
+        fshaderFileName = ":/OpenFBXQt-shaders/fshader-textured.glsl";
+    }
+    else
+    {
+        fshaderFileName = ":/OpenFBXQt-shaders/fshader-colored.glsl";
+    }
+
+    if (!shader.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/OpenFBXQt-shaders/vshader-baked-instanced.glsl"))
+    {
+        qWarning() << Q_FUNC_INFO << "failed to compile vertex shader";
+    }
+
+    if (!shader.addShaderFromSourceFile(QOpenGLShader::Fragment, fshaderFileName))
+    {
+        qWarning() << Q_FUNC_INFO << "failed to compile fragment shader";
+    }
+
+    if (!shader.link())
+    {
+        qWarning() << Q_FUNC_INFO << "failed to link shader";
+    }
+}
+
+void InstancedModel::paintGL(const QMatrix4x4& projection, const QVector<float>& instanceData_, const quint64 revision_, const double time_, FrameStatistics& statistics)
+{
+    const int instanceCount = instanceData_.count() / InstanceSize;
+    if (instanceCount == 0)
+    {
+        return;
+    }
+
+    if (!shader.isLinked())
+    {
+#ifdef QT_DEBUG
+        qCritical() << Q_FUNC_INFO << "shader not linked";
+#endif
+        return;
+    }
+
+    if (!model->isResident())
+    {
+        return;
+    }
+
+    if (!animation->texture)
+    {
+#ifdef QT_DEBUG
+        qCritical() << Q_FUNC_INFO << "animation texture is null";
+#endif
+        return;
+    }
+
+    const std::shared_ptr<ModelData>& data = model->data;
+    const std::shared_ptr<Material>& material = model->material;
+    const bool textured = material && material->diffuseTexture && material->diffuseTexture->texture;
+
+    if (!instanceBuffer.bind())
+    {
+#ifdef QT_DEBUG
+        qCritical() << Q_FUNC_INFO << "failed to bind instance buffer";
+#endif
+        return;
+    }
+
+    ++statistics.bufferBinds;
+
+    if (revision_ != uploadedRevision)
+    {
+        uploadedRevision = revision_;
+        instanceBuffer.allocate(instanceData_.constData(), instanceData_.count() * int(sizeof(float)));
+    }
+
+    instanceBuffer.release();
+
+    if (textured)
+    {
+        material->diffuseTexture->texture->bind(0);
+        ++statistics.textureBinds;
+    }
+
+    // the active unit is restored, other models bind their diffuse texture without a unit
+    animation->texture->bind(1, QOpenGLTexture::ResetTextureUnit);
+    ++statistics.textureBinds;
+
+    if (!shader.bind())
+    {
+#ifdef QT_DEBUG
+        qCritical() << Q_FUNC_INFO << "failed to bind shader";
+#endif
+    }
+
+    ++statistics.shaderBinds;
+
+    QVector3D v(0, 0, 0);
+    v = v.unproject(QMatrix4x4(), projection, QRect(0, 0, 1, 1));
+
+    setUniform(shader, "projection_pos", v, statistics);
+    setUniform(shader, "view_projection_matrix", projection, statistics);
+    setUniform(shader, "source_matrix", data->sourceMatrix, statistics);
+    setUniform(shader, "palette_texture", 1, statistics);
+    setUniform(shader, "palette_texel_size", QVector2D(1.0f / animation->getTextureWidth(), 1.0f / animation->getTextureHeight()), statistics);
+    setUniform(shader, "sample_rate", GLfloat(animation->getSampleRate()), statistics);
+    setUniform(shader, "duration", GLfloat(animation->getDuration()), statistics);
+    setUniform(shader, "last_frame", GLfloat(animation->getFrameCount() - 1), statistics);
+    setUniform(shader, "time", GLfloat(time_), statistics);
+
+    if (textured)
+    {
+        setUniform(shader, "texture", 0, statistics);
+    }
+    else if (material && material->diffuseColor)
+    {
+        setUniform(shader, "u_color", *material->diffuseColor, statistics);
+    }
+    else
+    {
+        setUniform(shader, "u_color", QColor(), statistics);
+    }
+
+    data->vertexBuffer.bind();
+    data->indexBuffer.bind();
+    statistics.bufferBinds += 2;
+
+    for (const VertexAttributeInfo& attribute : qAsConst(data->vertexAttributes))
+    {
+        const int location = shader.attributeLocation(attribute.nameForShader);
+        if (location == -1)
+        {
+            continue;
+        }
+
+        shader.enableAttributeArray(location);
+        shader.setAttributeBuffer(location, attribute.type, attribute.offset, attribute.tupleSize, data->vertexStride);
+    }
+
+    data->vertexBuffer.release();
+
+    // a mat4 attribute takes four consecutive locations, one per column
+    const int instanceStride = InstanceSize * sizeof(float);
+    const int matrixLocation = shader.attributeLocation("a_instance_matrix");
+    const int timeLocation = shader.attributeLocation("a_instance_time");
+
+    instanceBuffer.bind();
+    ++statistics.bufferBinds;
+
+    if (matrixLocation != -1)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            shader.enableAttributeArray(matrixLocation + column);
+            shader.setAttributeBuffer(matrixLocation + column, GL_FLOAT, column * 4 * sizeof(float), 4, instanceStride);
+            glVertexAttribDivisor(GLuint(matrixLocation + column), 1);
+        }
+    }
+
+    if (timeLocation != -1)
+    {
+        shader.enableAttributeArray(timeLocation);
+        shader.setAttributeBuffer(timeLocation, GL_FLOAT, 16 * sizeof(float), 2, instanceStride);
+        glVertexAttribDivisor(GLuint(timeLocation), 1);
+    }
+
+    glDrawElementsInstanced(data->drawElementsMode, data->indexCount, data->indexType, nullptr, instanceCount);
+    ++statistics.drawCalls;
+    statistics.triangles += qint64(data->indexCount / 3) * instanceCount;
+
+    // divisors are attribute state, other shaders may use the same locations
+    if (matrixLocation != -1)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            glVertexAttribDivisor(GLuint(matrixLocation + column), 0);
+            shader.disableAttributeArray(matrixLocation + column);
+        }
+    }
+
+    if (timeLocation != -1)
+    {
+        glVertexAttribDivisor(GLuint(timeLocation), 0);
+        shader.disableAttributeArray(timeLocation);
+    }
+
+    instanceBuffer.release();
+
+    shader.release();
+
+    animation->texture->release(1, QOpenGLTexture::ResetTextureUnit);
+
+    if (textured)
+    {
+        material->diffuseTexture->texture->release(0);
+    }
+
+    data->indexBuffer.release();
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "model.h"
+#include "bakedanimation.h"
+#include <QOpenGLExtraFunctions>
+
+namespace ofbxqt
+{
+
+// Draws many copies of a skinned model with one instanced draw call. Every instance has its own
+// world matrix and plays the baked animation with its own time offset and speed. Joints are not
+// evaluated on the CPU, the vertex shader reads palettes from the texture of the baked animation.
+// Requires OpenGL 3.3 or OpenGL ES 3.0
+class InstancedModel : protected QOpenGLExtraFunctions
+{
+public:
+    friend class Scene;
+
+    InstancedModel(std::shared_ptr<Model> model, std::shared_ptr<BakedAnimation> animation);
+
+    std::shared_ptr<Model> getModel() const { return model; }
+    std::shared_ptr<BakedAnimation> getAnimation() const { return animation; }
+
+    int addInstance(const QMatrix4x4& worldMatrix, const double timeOffset = 0, const double speed = 1);
+    void removeInstance(const int index);
+    void clearInstances();
+    int getInstanceCount() const { return instanceData.count() / InstanceSize; }
+
+    void setInstanceMatrix(const int index, const QMatrix4x4& worldMatrix);
+    void setInstanceTimeOffset(const int index, const double timeOffset);
+    void setInstanceSpeed(const int index, const double speed);
+
+    void play() { playing = true; }
+    void pause() { playing = false; }
+    bool isPlaying() const { return playing && !instanceData.isEmpty(); }
+
+    // Time of the shared clock, the time of an instance is time * speed + timeOffset
+    void seek(const double time_) { time = time_; }
+    double getTime() const { return time; }
+    void advance(const double deltaSeconds);
+
+    void initializeGL();
+    // Instance data come from a snapshot of the scene. The buffer is uploaded only when the revision changes
+    void paintGL(const QMatrix4x4& projection, const QVector<float>& instanceData, const quint64 revision, const double time, FrameStatistics& statistics);
+
+private:
+    // World matrix followed by time offset and speed
+    static const int InstanceSize = 16 + 2;
+
+    bool isValidIndex(const int index) const;
+
+    std::shared_ptr<Model> model;
+    std::shared_ptr<BakedAnimation> animation;
+
+    bool playing = true;
+    double time = 0;
+
+    QVector<float> instanceData; // implicitly shared with snapshots
+    quint64 revision = 0;
+
+    bool initializedGL = false;
+    quint64 uploadedRevision = 0;
+    QOpenGLBuffer instanceBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    QOpenGLShaderProgram shader;
+};
+
+}
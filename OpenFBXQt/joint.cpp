@@ -7,6 +7,12 @@ namespace ofbxqt
 void Joint::setTransform(const Transform &transform_)
 {
     transform = transform_;
+
+    const std::shared_ptr<Armature> armature_ = armature.lock();
+    if (armature_)
+    {
+        armature_->setJointDirty(index);
+    }
 }
 
 Joint::Joint(const QString& name_, const GLuint index_, const QMatrix4x4 &sourceMatrix_)
@@ -14,8 +14,13 @@ class Joint
 {
 public:
     friend class Loader;
+    friend class ModelCache;
     friend class Model;
     friend class Armature;
+    friend class AnimationClip;
+    friend class AnimationCrowd;
+    friend class Pose;
+    friend class PoseMask;
 
     std::weak_ptr<Armature> armature;
     std::weak_ptr<Joint> parent;
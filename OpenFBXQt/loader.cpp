@@ -1,4 +1,5 @@
 #include "loader.h"
+#include "loadtask.h"
 #include "joint.h"
 #include "OpenFBX/src/ofbx.h"
 #include <QFile>
@@ -7,61 +8,90 @@
 #include <QDebug>
 #include <QFileInfo>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QtMath>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <QCryptographicHash>
+#include <ctime>
+#include <limits>
+#include <random>
+#if defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 namespace ofbxqt
 {
 
-static bool shuffledSpareColor = false;
-static int currentSpareColors = 0;
-
-static QList<QColor> spareColors =
-{
-    QColor(239, 154, 154),
-    QColor(244, 67, 54),
-    QColor(183, 28, 28),
-    QColor(206, 147, 216),
-    QColor(156, 39, 176),
-    QColor(74, 20, 140),
-    QColor(179, 157, 219),
-    QColor(103, 58, 183),
-    QColor(49, 27, 146),
-    QColor(159, 168, 218),
-    QColor(33, 150, 243),
-    QColor(13, 71, 161),
-    QColor(129, 212, 250),
-    QColor(3, 169, 244),
-    QColor(1, 87, 155),
-    QColor(128, 222, 234),
-    QColor(0, 188, 212),
-    QColor(0, 96, 100),
-    QColor(128, 203, 196),
-    QColor(0, 150, 136),
-    QColor(0, 77, 64),
-    QColor(165, 214, 167),
-    QColor(76, 175, 80),
-    QColor(27, 94, 32),
-    QColor(197, 225, 165),
-    QColor(139, 195, 74),
-    QColor(51, 105, 30),
-    QColor(255, 245, 157),
-    QColor(255, 235, 59),
-    QColor(245, 127, 23),
-    QColor(255, 224, 130),
-    QColor(255, 193, 7),
-    QColor(255, 111, 0),
-    QColor(255, 204, 128),
-    QColor(255, 87, 34),
-    QColor(191, 54, 12),
-    QColor(188, 170, 164),
-    QColor(121, 85, 72),
-    QColor(62, 39, 35),
-    QColor(238, 238, 238),
-    QColor(158, 158, 158),
-    QColor(33, 33, 33),
-    QColor(176, 190, 197),
-    QColor(96, 125, 139),
-    QColor(38, 50, 56),
-};
+// Shuffled once per process, initialization of a local static is thread safe
+static const QList<QColor>& getSpareColors()
+{
+    static const QList<QColor> spareColors = []()
+    {
+        QList<QColor> colors =
+        {
+            QColor(239, 154, 154),
+            QColor(244, 67, 54),
+            QColor(183, 28, 28),
+            QColor(206, 147, 216),
+            QColor(156, 39, 176),
+            QColor(74, 20, 140),
+            QColor(179, 157, 219),
+            QColor(103, 58, 183),
+            QColor(49, 27, 146),
+            QColor(159, 168, 218),
+            QColor(33, 150, 243),
+            QColor(13, 71, 161),
+            QColor(129, 212, 250),
+            QColor(3, 169, 244),
+            QColor(1, 87, 155),
+            QColor(128, 222, 234),
+            QColor(0, 188, 212),
+            QColor(0, 96, 100),
+            QColor(128, 203, 196),
+            QColor(0, 150, 136),
+            QColor(0, 77, 64),
+            QColor(165, 214, 167),
+            QColor(76, 175, 80),
+            QColor(27, 94, 32),
+            QColor(197, 225, 165),
+            QColor(139, 195, 74),
+            QColor(51, 105, 30),
+            QColor(255, 245, 157),
+            QColor(255, 235, 59),
+            QColor(245, 127, 23),
+            QColor(255, 224, 130),
+            QColor(255, 193, 7),
+            QColor(255, 111, 0),
+            QColor(255, 204, 128),
+            QColor(255, 87, 34),
+            QColor(191, 54, 12),
+            QColor(188, 170, 164),
+            QColor(121, 85, 72),
+            QColor(62, 39, 35),
+            QColor(238, 238, 238),
+            QColor(158, 158, 158),
+            QColor(33, 33, 33),
+            QColor(176, 190, 197),
+            QColor(96, 125, 139),
+            QColor(38, 50, 56),
+        };
+
+        std::shuffle(colors.begin(), colors.end(), std::mt19937(std::random_device()()));
+
+        return colors;
+    }();
+
+    return spareColors;
+}
+
+// Shared by all loaders, so models of consecutive files get different colors
+static QAtomicInt nextSpareColor;
 
 static QMatrix4x4 convertMatrix4x4(const ofbx::Matrix& source)
 {
@@ -102,6 +132,233 @@ static QString textureTypeToString(const ofbx::Texture::TextureType type)
     return "<UNKNOWN>";
 }
 
+static void decomposeMatrix(const QMatrix4x4& matrix, QVector3D& translation, QQuaternion& rotation, QVector3D& scale)
+{
+    translation = matrix.column(3).toVector3D();
+
+    QVector3D axisX = matrix.column(0).toVector3D();
+    QVector3D axisY = matrix.column(1).toVector3D();
+    QVector3D axisZ = matrix.column(2).toVector3D();
+
+    scale = QVector3D(axisX.length(), axisY.length(), axisZ.length());
+    if (QVector3D::dotProduct(QVector3D::crossProduct(axisX, axisY), axisZ) < 0)
+    {
+        scale.setX(-scale.x());
+    }
+
+    if (qFuzzyIsNull(scale.x()) || qFuzzyIsNull(scale.y()) || qFuzzyIsNull(scale.z()))
+    {
+        rotation = QQuaternion();
+        return;
+    }
+
+    axisX /= scale.x();
+    axisY /= scale.y();
+    axisZ /= scale.z();
+
+    QMatrix3x3 rotationMatrix;
+    rotationMatrix(0, 0) = axisX.x(); rotationMatrix(0, 1) = axisY.x(); rotationMatrix(0, 2) = axisZ.x();
+    rotationMatrix(1, 0) = axisX.y(); rotationMatrix(1, 1) = axisY.y(); rotationMatrix(1, 2) = axisZ.y();
+    rotationMatrix(2, 0) = axisX.z(); rotationMatrix(2, 1) = axisY.z(); rotationMatrix(2, 2) = axisZ.z();
+
+    rotation = QQuaternion::fromRotationMatrix(rotationMatrix).normalized();
+}
+
+// Evaluates global matrices of objects of one animation layer at a given time
+class LayerSampler
+{
+public:
+    explicit LayerSampler(const ofbx::AnimationLayer& layer_)
+        : layer(layer_)
+    {}
+
+    bool isAnimated(const ofbx::Object* object)
+    {
+        while (object)
+        {
+            const CurveNodes& nodes = getCurveNodes(object);
+            if (nodes.translation || nodes.rotation || nodes.scaling)
+            {
+                return true;
+            }
+
+            object = object->getParent();
+        }
+
+        return false;
+    }
+
+    QMatrix4x4 getGlobalMatrix(const ofbx::Object* object, const double time)
+    {
+        if (time != cachedTime)
+        {
+            cachedTime = time;
+            globalMatrices.clear();
+        }
+
+        const auto it = globalMatrices.constFind(object);
+        if (it != globalMatrices.constEnd())
+        {
+            return *it;
+        }
+
+        QMatrix4x4 matrix = getLocalMatrix(object, time);
+
+        const ofbx::Object* parent = object->getParent();
+        if (parent)
+        {
+            matrix = getGlobalMatrix(parent, time) * matrix;
+        }
+
+        globalMatrices.insert(object, matrix);
+
+        return matrix;
+    }
+
+    void collectTimeRange(const ofbx::Object* object, double& from, double& to)
+    {
+        const CurveNodes& nodes = getCurveNodes(object);
+        for (const ofbx::AnimationCurveNode* node : { nodes.translation, nodes.rotation, nodes.scaling })
+        {
+            if (!node)
+            {
+                continue;
+            }
+
+            for (int i = 0; i < 3; ++i)
+            {
+                const ofbx::AnimationCurve* curve = node->getCurve(i);
+                if (!curve || curve->getKeyCount() <= 0)
+                {
+                    continue;
+                }
+
+                from = qMin(from, ofbx::fbxTimeToSeconds(curve->getKeyTime()[0]));
+                to = qMax(to, ofbx::fbxTimeToSeconds(curve->getKeyTime()[curve->getKeyCount() - 1]));
+            }
+        }
+    }
+
+private:
+    struct CurveNodes
+    {
+        const ofbx::AnimationCurveNode* translation = nullptr;
+        const ofbx::AnimationCurveNode* rotation = nullptr;
+        const ofbx::AnimationCurveNode* scaling = nullptr;
+    };
+
+    const CurveNodes& getCurveNodes(const ofbx::Object* object)
+    {
+        auto it = curveNodes.find(object);
+        if (it == curveNodes.end())
+        {
+            CurveNodes nodes;
+            nodes.translation = layer.getCurveNode(*object, "Lcl Translation");
+            nodes.rotation = layer.getCurveNode(*object, "Lcl Rotation");
+            nodes.scaling = layer.getCurveNode(*object, "Lcl Scaling");
+            it = curveNodes.insert(object, nodes);
+        }
+
+        return *it;
+    }
+
+    QMatrix4x4 getLocalMatrix(const ofbx::Object* object, const double time)
+    {
+        const CurveNodes& nodes = getCurveNodes(object);
+
+        const ofbx::Vec3 translation = nodes.translation ? nodes.translation->getNodeLocalTransform(time) : object->getLocalTranslation();
+        const ofbx::Vec3 rotation = nodes.rotation ? nodes.rotation->getNodeLocalTransform(time) : object->getLocalRotation();
+        const ofbx::Vec3 scaling = nodes.scaling ? nodes.scaling->getNodeLocalTransform(time) : object->getLocalScaling();
+
+        return convertMatrix4x4(object->evalLocal(translation, rotation, scaling));
+    }
+
+    const ofbx::AnimationLayer& layer;
+    QHash<const ofbx::Object*, CurveNodes> curveNodes;
+    QHash<const ofbx::Object*, QMatrix4x4> globalMatrices;
+    double cachedTime = -1;
+};
+
+// Processor time of the calling thread, loads running in parallel do not add to it
+static double getThreadCpuMs()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+    {
+        const quint64 kernelTime = (quint64(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+        const quint64 userTime = (quint64(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+        return double(kernelTime + userTime) / 10000; // 100 ns units
+    }
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+    {
+        return double(ts.tv_sec) * 1000 + double(ts.tv_nsec) / 1000000;
+    }
+#endif
+    return double(std::clock()) * 1000 / CLOCKS_PER_SEC;
+}
+
+// The same clock for the stage statistics of ofbx::load(), which counts in seconds
+static double getThreadCpuSeconds()
+{
+    return getThreadCpuMs() / 1000;
+}
+
+// Adds the wall and processor time of its scope to a phase, without the time the nested phases got meanwhile
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(PhaseTime& phase_, const QVector<const PhaseTime*>& nested_ = QVector<const PhaseTime*>())
+        : phase(phase_)
+        , nested(nested_)
+        , cpuStart(getThreadCpuMs())
+    {
+        nestedStart = getNestedTime();
+        timer.start();
+    }
+
+    ~PhaseTimer()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (stopped)
+        {
+            return;
+        }
+
+        stopped = true;
+
+        const PhaseTime nestedTime = getNestedTime();
+        phase.wallMs += timer.nsecsElapsed() / 1000000.0 - (nestedTime.wallMs - nestedStart.wallMs);
+        phase.cpuMs += getThreadCpuMs() - cpuStart - (nestedTime.cpuMs - nestedStart.cpuMs);
+    }
+
+private:
+    PhaseTime getNestedTime() const
+    {
+        PhaseTime result;
+        for (const PhaseTime* time : nested)
+        {
+            result.wallMs += time->wallMs;
+            result.cpuMs += time->cpuMs;
+        }
+
+        return result;
+    }
+
+    PhaseTime& phase;
+    const QVector<const PhaseTime*> nested;
+    PhaseTime nestedStart;
+    QElapsedTimer timer;
+    const double cpuStart;
+    bool stopped = false;
+};
+
 static bool compareJointData(const QPair<GLuint, GLfloat>& joint1, const QPair<GLuint, GLfloat>& joint2)
 {
     return joint1.second >= joint2.second;
@@ -136,39 +393,151 @@ static bool isCompatibleAxisDirection(const ModelData::AxisDirection a, const Mo
 }
 
 Loader::Loader()
+    : storage(ownStorage)
+{
+}
+
+Loader::Loader(DataStorage& storage_)
+    : storage(storage_)
 {
-    if (!shuffledSpareColor)
-    {
-        shuffledSpareColor = true;
-        std::random_shuffle(spareColors.begin(), spareColors.end());
-    }
 }
 
-FileInfo Loader::open(const QString &fileName, const OpenModelConfig config_)
+FileInfo Loader::open(const QString &fileName, const OpenModelConfig config_, LoadTask* task_)
 {
     config = config_;
+    task = task_;
 
     fileInfo = FileInfo();
+    jointBindings.clear();
+    modelsByObjects.clear();
+    pendingTextures.clear();
+    textureReferences.clear();
+    textureNotes.clear();
+    cacheable = true;
     fileInfo.absoluteFileName = fileName;
     fileInfo.fileName = QFileInfo(fileName).fileName();
 
+    {
+        PhaseTimer timer(fileInfo.statistics.total);
+        openFile(fileName);
+    }
+
+    collectStatistics();
+
+    return fileInfo;
+}
+
+void Loader::openFile(const QString& fileName)
+{
+    LoadStatistics& statistics = fileInfo.statistics;
+    // textures are resolved while reading a cached model
+    PhaseTimer readTimer(statistics.read, { &statistics.textures });
+
     QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly))
     {
         addNote(Note::Type::Error, QTranslator::tr("Failed to open file \"%1\", error: \"%2\"").arg(fileName, file.errorString()));
         qCritical() << Q_FUNC_INFO << "failed to open file" << fileName << ", error:" << file.errorString();
-        return fileInfo;
+        return;
+    }
+
+    // QByteArray of Qt 5 and ofbx::load() index the data with int
+    if (file.size() > std::numeric_limits<int>::max())
+    {
+        addNote(Note::Type::Error, QTranslator::tr("File \"%1\" is too large, %2 bytes, at most %3 bytes are supported").arg(fileName).arg(file.size()).arg(std::numeric_limits<int>::max()));
+        qCritical() << Q_FUNC_INFO << "file" << fileName << "is too large," << file.size() << "bytes";
+        return;
+    }
+
+    if (task)
+    {
+        task->setPhase(LoadTask::Phase::Reading);
+        task->setBytes(0, file.size());
+    }
+
+    // read in chunks to report progress and to stop early on cancellation
+    static const qint64 ReadChunkSize = 4 * 1024 * 1024;
+    fileData = QByteArray(int(file.size()), Qt::Uninitialized);
+    qint64 bytesRead = 0;
+    while (bytesRead < fileData.size())
+    {
+        const qint64 result = file.read(fileData.data() + bytesRead, qMin(ReadChunkSize, fileData.size() - bytesRead));
+        if (result <= 0)
+        {
+            addNote(Note::Type::Error, QTranslator::tr("Failed to read file \"%1\", error: \"%2\"").arg(fileName, file.errorString()));
+            qCritical() << Q_FUNC_INFO << "failed to read file" << fileName << ", error:" << file.errorString();
+            return;
+        }
+
+        bytesRead += result;
+        statistics.bytesRead = bytesRead;
+
+        if (task)
+        {
+            task->setBytes(bytesRead, fileData.size());
+        }
+
+        if (checkCanceled())
+        {
+            return;
+        }
     }
 
-    const QByteArray rawData = file.readAll();
     file.close();
 
-    ofbx::IScene* scene = ofbx::load((ofbx::u8*)rawData.constData(), rawData.size(), (ofbx::u64)ofbx::LoadFlags::TRIANGULATE);
+    // the hash of the file is much cheaper than parsing it
+    QByteArray contentHash;
+    if (!config.modelCacheDirectory.isEmpty())
+    {
+        contentHash = QCryptographicHash::hash(fileData, QCryptographicHash::Sha1);
+
+        if (openFromModelCache(contentHash))
+        {
+            readTimer.stop();
+            statistics.fromModelCache = true;
+            fileData.clear();
+
+            PhaseTimer texturesTimer(statistics.textures);
+            joinTextures();
+            return;
+        }
+    }
+
+    readTimer.stop();
+
+    if (task)
+    {
+        task->setPhase(LoadTask::Phase::Parsing);
+    }
+
+    // the scene references the data, so embedded media can be decoded from it without copies
+    ofbx::IScene* scene = ofbx::load((ofbx::u8*)fileData.constData(), fileData.size(),
+                                     (ofbx::u64)ofbx::LoadFlags::TRIANGULATE | (ofbx::u64)ofbx::LoadFlags::NO_DATA_COPY,
+                                     nullptr, nullptr, getThreadCpuSeconds);
     if (!scene)
     {
-        addNote(Note::Type::Error, QTranslator::tr("No scene"));
-        qCritical() << Q_FUNC_INFO << "no scene";
-        return fileInfo;
+        addNote(Note::Type::Error, QTranslator::tr("No scene, error: \"%1\"").arg(ofbx::getError()));
+        qCritical() << Q_FUNC_INFO << "no scene, error:" << ofbx::getError();
+        return;
+    }
+
+    const ofbx::LoadStatistics& sceneStatistics = scene->getLoadStatistics();
+    statistics.tokenize.wallMs = sceneStatistics.tokenize_time * 1000;
+    statistics.tokenize.cpuMs = sceneStatistics.tokenize_cpu_time * 1000;
+    statistics.inflate.wallMs = sceneStatistics.inflate_time * 1000;
+    statistics.inflate.cpuMs = sceneStatistics.inflate_cpu_time * 1000;
+    statistics.objects.wallMs = (sceneStatistics.connections_time + sceneStatistics.takes_time + sceneStatistics.objects_time - sceneStatistics.geometry_time) * 1000;
+    statistics.objects.cpuMs = (sceneStatistics.connections_cpu_time + sceneStatistics.takes_cpu_time + sceneStatistics.objects_cpu_time - sceneStatistics.geometry_cpu_time) * 1000;
+    statistics.geometry.wallMs = sceneStatistics.geometry_time * 1000;
+    statistics.geometry.cpuMs = sceneStatistics.geometry_cpu_time * 1000;
+    statistics.compressedBytes = qint64(sceneStatistics.compressed_bytes);
+    statistics.inflatedBytes = qint64(sceneStatistics.inflated_bytes);
+    statistics.arenaBytes = qint64(sceneStatistics.arena_bytes);
+
+    if (checkCanceled())
+    {
+        scene->destroy();
+        return;
     }
 
     // TODO: need to add the ability to change the direction of the axes for the scene or software
@@ -209,21 +578,41 @@ FileInfo Loader::open(const QString &fileName, const OpenModelConfig config_)
         scene->destroy();
         addNote(Note::Type::Error, QTranslator::tr("No meshes in scene"));
         qCritical() << Q_FUNC_INFO << "no meshes in scene";
-        return fileInfo;
+        return;
     }
 
     const QString absoluteDirectoryPath = QFileInfo(fileName).absoluteDir().absolutePath();
 
     QVector<QPair<const ofbx::Mesh*, std::shared_ptr<Model>>> modelBinds;
 
+    if (task)
+    {
+        task->setPhase(LoadTask::Phase::Meshes);
+        task->setItems(0, meshCount);
+    }
+
     QVector<std::shared_ptr<Model>> allModels;
     for (int i = 0; i < meshCount; ++i)
     {
+        if (checkCanceled())
+        {
+            scene->destroy();
+            return;
+        }
+
+        if (task)
+        {
+            task->setItems(i, meshCount);
+        }
+
         const ofbx::Mesh* mesh = scene->getMesh(i);
+        PhaseTimer meshTimer(statistics.meshes, { &statistics.skin, &statistics.materials, &statistics.textures });
         std::shared_ptr<Model> model = loadMesh(mesh, i, absoluteDirectoryPath);
+        meshTimer.stop();
         if (model)
         {
             allModels.append(model);
+            modelsByObjects.insert(mesh, model);
         }
 
         modelBinds.append(QPair<const ofbx::Mesh*, std::shared_ptr<Model>>(mesh, model ? model : nullptr));
@@ -271,9 +660,37 @@ FileInfo Loader::open(const QString &fileName, const OpenModelConfig config_)
         }
     }
 
+    if (config.loadAnimation && !checkCanceled())
+    {
+        if (task)
+        {
+            task->setPhase(LoadTask::Phase::Animations);
+        }
+
+        PhaseTimer animationsTimer(statistics.animations);
+        loadAnimations(scene);
+    }
+
+    // everything is held at once here, except images which are still decoded
+    statistics.estimatedPeakBytes = statistics.bytesRead + statistics.arenaBytes + statistics.inflatedBytes;
+    for (const std::shared_ptr<Model>& model : qAsConst(allModels))
+    {
+        statistics.estimatedPeakBytes += model->data->vertexData.size() + model->data->indexData.size();
+    }
+
     scene->destroy();
 
-    return fileInfo;
+    if (!config.modelCacheDirectory.isEmpty() && !(task && task->isCancelRequested()))
+    {
+        writeModelCache(contentHash);
+    }
+
+    fileData.clear();
+
+    PhaseTimer texturesTimer(statistics.textures);
+    joinTextures();
+
+    return;
 }
 
 void Loader::addNote(const Note::Type type, const QString &text)
@@ -281,6 +698,23 @@ void Loader::addNote(const Note::Type type, const QString &text)
     fileInfo.notes.append(Note(type, text));
 }
 
+bool Loader::checkCanceled()
+{
+    if (!task || !task->isCancelRequested())
+    {
+        return false;
+    }
+
+    // models loaded so far are dropped
+    fileInfo.topLevelModels.clear();
+    fileInfo.allModels.clear();
+    fileInfo.animationClips.clear();
+
+    addNote(Note::Type::Warning, QTranslator::tr("Loading canceled"));
+
+    return true;
+}
+
 void Loader::loadJoints(const ofbx::Skin* skin, ModelData& data, QHash<GLuint, QVector<QPair<GLuint, GLfloat>>>& resultJointsData)
 {
     if (!skin)
@@ -328,7 +762,6 @@ void Loader::loadJoints(const ofbx::Skin* skin, ModelData& data, QHash<GLuint, Q
         joint->armature = data.armature;
 
         clustersByJoints[joint] = cluster;
-        data.armature->jointsMatrices.append(QMatrix4x4());
 
         objectsJoints.insert(object, joint);
 
@@ -373,6 +806,25 @@ void Loader::loadJoints(const ofbx::Skin* skin, ModelData& data, QHash<GLuint, Q
         }
     }
 
+    data.armature->buildEvaluationOrder();
+
+    for (auto it = objectsJoints.constBegin(); it != objectsJoints.constEnd(); ++it)
+    {
+        JointBinding binding;
+        binding.joint = it.value();
+        binding.object = it.key();
+        binding.inverseLinkMatrix = convertMatrix4x4(clustersByJoints[binding.joint]->getTransformLinkMatrix()).inverted();
+
+        const ofbx::Object* parent = binding.object->getParent();
+        if (parent && objectsJoints.contains(parent))
+        {
+            binding.parentObject = parent;
+            binding.parentLinkMatrix = convertMatrix4x4(clustersByJoints[objectsJoints[parent]]->getTransformLinkMatrix());
+        }
+
+        jointBindings.append(binding);
+    }
+
     static const int MaxJointsSupported = 100;
     if (data.armature->allJoints.count() > MaxJointsSupported)
     {
@@ -485,6 +937,7 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
 
         if (materialsCount > 0)
         {
+            PhaseTimer timer(fileInfo.statistics.materials, { &fileInfo.statistics.textures });
             loadMaterial(mesh->getMaterial(0), material, meshIndex, 0, absoluteDirectoryPath);
         }
         else
@@ -498,16 +951,10 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
     {
         QColor* color = new QColor(191, 191, 191);
 
+        const QList<QColor>& spareColors = getSpareColors();
         if (!spareColors.isEmpty())
         {
-            if (currentSpareColors >= spareColors.count())
-            {
-                currentSpareColors = 0;
-            }
-
-            *color = spareColors[currentSpareColors];
-
-            currentSpareColors++;
+            *color = spareColors[int(quint32(nextSpareColor.fetchAndAddRelaxed(1)) % quint32(spareColors.count()))];
         }
         else
         {
@@ -522,29 +969,7 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
     data->name = QString(mesh->name);
 
     data->material = material;
-    data->sourceMatrix = QMatrix4x4();
-
-    switch (upDirection)
-    {
-    case ofbxqt::ModelData::AxisDirection::XPlus:
-        data->sourceMatrix.rotate(90, QVector3D(0, 1, 0));
-        break;
-    case ofbxqt::ModelData::AxisDirection::XMinus:
-        data->sourceMatrix.rotate(90, QVector3D(0, -1, 0));
-        break;
-    case ofbxqt::ModelData::AxisDirection::YPlus:
-        data->sourceMatrix.rotate(90, QVector3D(1, 0, 0));
-        break;
-    case ofbxqt::ModelData::AxisDirection::YMinus:
-        data->sourceMatrix.rotate(90, QVector3D(-1, 0, 0));
-        break;
-    case ofbxqt::ModelData::AxisDirection::ZPlus:
-        data->sourceMatrix.scale(1, 1, 1);
-        break;
-    case ofbxqt::ModelData::AxisDirection::ZMinus:
-        data->sourceMatrix.scale(1, 1, -1);
-        break;
-    }
+    data->sourceMatrix = getAxisMatrix();
 
     //qDebug() << "up =" << ModelData::axisDirectionToString(upDirection);
 
@@ -590,10 +1015,17 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
         const ofbx::Skin* skin = geometry->getSkin();
         if (skin)
         {
+            PhaseTimer timer(fileInfo.statistics.skin);
             loadJoints(skin, *data, jointsData);
         }
     }
 
+    QVector<QPair<int, int>> morphRanges;
+    if (config.loadMorphTargets)
+    {
+        loadMorphTargets(geometry, *data, morphRanges, meshIndex);
+    }
+
     int idx = 0;
 
     addVertexAttributeGLfloat(*data, "a_position", 3);
@@ -611,6 +1043,11 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
         addVertexAttributeGLfloat(*data, "a_joint_indices", 4);
     }
 
+    if (!morphRanges.isEmpty())
+    {
+        addVertexAttributeGLfloat(*data, "a_morph_range", 2);
+    }
+
     data->vertexCount = geometry->getVertexCount();
     data->vertexData.resize(data->vertexCount * data->vertexStride);
 
@@ -621,6 +1058,18 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
     idx = 0;
     for (int vertexIndex = 0; vertexIndex < data->vertexCount; ++vertexIndex)
     {
+        const QVector3D position((float)positions[vertexIndex].x, (float)positions[vertexIndex].y, (float)positions[vertexIndex].z);
+        if (vertexIndex == 0)
+        {
+            data->boundsMin = position;
+            data->boundsMax = position;
+        }
+        else
+        {
+            data->boundsMin = QVector3D(qMin(data->boundsMin.x(), position.x()), qMin(data->boundsMin.y(), position.y()), qMin(data->boundsMin.z(), position.z()));
+            data->boundsMax = QVector3D(qMax(data->boundsMax.x(), position.x()), qMax(data->boundsMax.y(), position.y()), qMax(data->boundsMax.z(), position.z()));
+        }
+
         rawVertexArray[idx++] = (GLfloat)positions[vertexIndex].x;
         rawVertexArray[idx++] = (GLfloat)positions[vertexIndex].y;
         rawVertexArray[idx++] = (GLfloat)positions[vertexIndex].z;
@@ -675,6 +1124,12 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
                 }
             }
         }
+
+        if (!morphRanges.isEmpty())
+        {
+            rawVertexArray[idx++] = (GLfloat)morphRanges[vertexIndex].first;
+            rawVertexArray[idx++] = (GLfloat)morphRanges[vertexIndex].second;
+        }
     }
 
     if (foundTooMuchJointsCount != -1)
@@ -716,7 +1171,6 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
         qWarning() << Q_FUNC_INFO << "rawIndex less than zero but i == 0";
     }
 
-    DataStorage::getInstance().data.push_back(data);
     std::shared_ptr<Model> model(new Model(data));
 
     if (data->armature)
@@ -729,25 +1183,160 @@ std::shared_ptr<Model> Loader::loadMesh(const ofbx::Mesh *mesh, const int meshIn
     return model;
 }
 
-void Loader::loadMaterial(const ofbx::Material *rawMaterial, std::shared_ptr<Material> material, const int meshIndex, const int materialIndex, const QString& absoluteDirectoryPath)
+static bool isZeroMorphDelta(const ofbx::Vec3& vertexDelta, const ofbx::Vec3& normalDelta)
 {
-    if (!rawMaterial)
-    {
-        addNote(Note::Type::Error, QTranslator::tr("Internal error"));
-        qCritical() << Q_FUNC_INFO << "raw material is null, mesh index =" << meshIndex << ", material index =" << materialIndex;
-        return;
-    }
+    static const double Epsilon = 1e-6;
 
-    if (!material)
+    return qAbs(vertexDelta.x) < Epsilon && qAbs(vertexDelta.y) < Epsilon && qAbs(vertexDelta.z) < Epsilon &&
+           qAbs(normalDelta.x) < Epsilon && qAbs(normalDelta.y) < Epsilon && qAbs(normalDelta.z) < Epsilon;
+}
+
+void Loader::loadMorphTargets(const ofbx::Geometry* geometry, ModelData& data, QVector<QPair<int, int>>& vertexRanges, const int meshIndex)
+{
+    const ofbx::BlendShape* blendShape = geometry->getBlendShape();
+    if (!blendShape)
     {
-        addNote(Note::Type::Error, QTranslator::tr("Internal error"));
-        qCritical() << Q_FUNC_INFO << "material is null, mesh index =" << meshIndex << ", material index =" << materialIndex;
         return;
     }
 
-    for (int i = 0; i < (int)ofbx::Texture::TextureType::COUNT; ++i)
+    const int vertexCount = geometry->getVertexCount();
+
+    // every channel is a target, in-between shapes are not supported so the last shape is the full one
+    QVector<const ofbx::Shape*> shapes;
+    for (int i = 0; i < blendShape->getBlendShapeChannelCount(); ++i)
     {
-        const ofbx::Texture::TextureType type = (ofbx::Texture::TextureType)i;
+        const ofbx::BlendShapeChannel* channel = blendShape->getBlendShapeChannel(i);
+        if (!channel || channel->getShapeCount() <= 0)
+        {
+            continue;
+        }
+
+        const ofbx::Shape* shape = channel->getShape(channel->getShapeCount() - 1);
+        if (!shape || shape->getIndexCount() <= 0)
+        {
+            continue;
+        }
+
+        MorphTarget target;
+        target.name = QString(channel->name);
+        target.defaultWeight = float(channel->getDeformPercent() / 100.0);
+
+        data.morphTargets.append(target);
+        shapes.append(shape);
+    }
+
+    if (shapes.isEmpty())
+    {
+        return;
+    }
+
+    // entries are grouped by vertex, so the vertex shader reads one contiguous range
+    vertexRanges.fill(QPair<int, int>(0, 0), vertexCount);
+    for (const ofbx::Shape* shape : qAsConst(shapes))
+    {
+        const int* indices = shape->getIndices();
+        for (int i = 0; i < shape->getIndexCount(); ++i)
+        {
+            if (indices[i] >= 0 && indices[i] < vertexCount && !isZeroMorphDelta(shape->getVertexDeltas()[i], shape->getNormalDeltas()[i]))
+            {
+                vertexRanges[indices[i]].second++;
+            }
+        }
+    }
+
+    int foundTooMuchTargetsCount = -1;
+    int entryCount = 0;
+    for (QPair<int, int>& range : vertexRanges)
+    {
+        if (range.second > ModelData::MaxMorphTargetsPerVertex)
+        {
+            foundTooMuchTargetsCount = qMax(foundTooMuchTargetsCount, range.second);
+            range.second = ModelData::MaxMorphTargetsPerVertex;
+        }
+
+        range.first = entryCount;
+        entryCount += range.second;
+        range.second = 0;
+    }
+
+    static const int TexelsPerEntry = 2;
+    const int rowCount = (entryCount * TexelsPerEntry + ModelData::MorphTextureWidth - 1) / ModelData::MorphTextureWidth;
+    data.morphData.fill(0, qMax(rowCount, 1) * ModelData::MorphTextureWidth * 4);
+
+    for (int targetIndex = 0; targetIndex < shapes.count(); ++targetIndex)
+    {
+        const ofbx::Shape* shape = shapes[targetIndex];
+        const int* indices = shape->getIndices();
+        const ofbx::Vec3* vertexDeltas = shape->getVertexDeltas();
+        const ofbx::Vec3* normalDeltas = shape->getNormalDeltas();
+
+        for (int i = 0; i < shape->getIndexCount(); ++i)
+        {
+            const int vertexIndex = indices[i];
+            if (vertexIndex < 0 || vertexIndex >= vertexCount)
+            {
+                continue;
+            }
+
+            const ofbx::Vec3& vertexDelta = vertexDeltas[i];
+            const ofbx::Vec3& normalDelta = normalDeltas[i];
+            if (isZeroMorphDelta(vertexDelta, normalDelta))
+            {
+                continue;
+            }
+
+            QPair<int, int>& range = vertexRanges[vertexIndex];
+            if (range.second >= ModelData::MaxMorphTargetsPerVertex)
+            {
+                continue;
+            }
+
+            float* entry = data.morphData.data() + (range.first + range.second) * TexelsPerEntry * 4;
+            range.second++;
+
+            entry[0] = (float)vertexDelta.x;
+            entry[1] = (float)vertexDelta.y;
+            entry[2] = (float)vertexDelta.z;
+            entry[3] = (float)targetIndex;
+            entry[4] = (float)normalDelta.x;
+            entry[5] = (float)normalDelta.y;
+            entry[6] = (float)normalDelta.z;
+            entry[7] = 0;
+        }
+    }
+
+    data.morphEntryCount = entryCount;
+
+    if (foundTooMuchTargetsCount != -1)
+    {
+        addNote(Note::Type::Warning, QTranslator::tr("More than %1 morph targets per vertex not supported, found %2. Extra targets will be ignored. Mesh %3")
+                          .arg(ModelData::MaxMorphTargetsPerVertex).arg(foundTooMuchTargetsCount).arg(meshIndex));
+        qWarning() << Q_FUNC_INFO << "more than" << ModelData::MaxMorphTargetsPerVertex << "morph targets per vertex not supported, found" << foundTooMuchTargetsCount << ". Extra targets will be ignored, mesh" << meshIndex;
+    }
+
+    addNote(Note::Type::Info, QTranslator::tr("%1 morph targets, %2 deltas. Mesh %3")
+                      .arg(data.morphTargets.count()).arg(entryCount).arg(meshIndex));
+}
+
+void Loader::loadMaterial(const ofbx::Material *rawMaterial, std::shared_ptr<Material> material, const int meshIndex, const int materialIndex, const QString& absoluteDirectoryPath)
+{
+    if (!rawMaterial)
+    {
+        addNote(Note::Type::Error, QTranslator::tr("Internal error"));
+        qCritical() << Q_FUNC_INFO << "raw material is null, mesh index =" << meshIndex << ", material index =" << materialIndex;
+        return;
+    }
+
+    if (!material)
+    {
+        addNote(Note::Type::Error, QTranslator::tr("Internal error"));
+        qCritical() << Q_FUNC_INFO << "material is null, mesh index =" << meshIndex << ", material index =" << materialIndex;
+        return;
+    }
+
+    for (int i = 0; i < (int)ofbx::Texture::TextureType::COUNT; ++i)
+    {
+        const ofbx::Texture::TextureType type = (ofbx::Texture::TextureType)i;
         const QString textureTypeStr = textureTypeToString(type);
 
         const ofbx::Texture* rawTexture = rawMaterial->getTexture(type);
@@ -760,7 +1349,15 @@ void Loader::loadMaterial(const ofbx::Material *rawMaterial, std::shared_ptr<Mat
                 isSupportedTextureType = true;
                 if (config.loadDiffuseTexture)
                 {
-                    material->diffuseTexture = loadTexture(rawTexture, absoluteDirectoryPath, meshIndex, materialIndex, type);
+                    PhaseTimer timer(fileInfo.statistics.textures);
+                    ModelCache::TextureReference reference;
+                    material->diffuseTexture = loadTexture(rawTexture, absoluteDirectoryPath, meshIndex, materialIndex, type, reference);
+
+                    if (!reference.isEmpty())
+                    {
+                        reference.material = material;
+                        textureReferences.append(reference);
+                    }
                 }
                 break;
 
@@ -789,7 +1386,7 @@ void Loader::loadMaterial(const ofbx::Material *rawMaterial, std::shared_ptr<Mat
     }
 }
 
-std::shared_ptr<TextureInfo> Loader::loadTexture(const ofbx::Texture* rawTexture, const QString &absoluteDirectoryPath, const int meshIndex, const int materialIndex, ofbx::Texture::TextureType type)
+std::shared_ptr<TextureInfo> Loader::loadTexture(const ofbx::Texture* rawTexture, const QString &absoluteDirectoryPath, const int meshIndex, const int materialIndex, ofbx::Texture::TextureType type, ModelCache::TextureReference& reference)
 {
     const QString textureTypeStr = textureTypeToString(type);
     if (!rawTexture)
@@ -799,6 +1396,34 @@ std::shared_ptr<TextureInfo> Loader::loadTexture(const ofbx::Texture* rawTexture
         return nullptr;
     }
 
+    reference.typeStr = textureTypeStr;
+    reference.meshIndex = meshIndex;
+    reference.materialIndex = materialIndex;
+
+    const ofbx::DataView embeddedData = rawTexture->getEmbeddedData();
+    if (embeddedData.begin && embeddedData.end > embeddedData.begin)
+    {
+        reference.name = QFileInfo(convertString2048(rawTexture->getRelativeFileName())).fileName();
+        if (reference.name.isEmpty())
+        {
+            reference.name = QFileInfo(convertString2048(rawTexture->getFileName())).fileName();
+        }
+
+        // the model cache finds the data again in the file
+        const char* begin = reinterpret_cast<const char*>(embeddedData.begin);
+        const char* end = reinterpret_cast<const char*>(embeddedData.end);
+        if (begin >= fileData.constData() && end <= fileData.constData() + fileData.size())
+        {
+            reference.embeddedOffset = begin - fileData.constData();
+            reference.embeddedSize = end - begin;
+            return resolveTexture(reference);
+        }
+
+        cacheable = false;
+
+        return loadEmbeddedTexture(reference.name, embeddedData, meshIndex, materialIndex, textureTypeStr);
+    }
+
     //TODO: implement search in relative directory path
     const QString rawRelativeFileName = convertString2048(rawTexture->getRelativeFileName());
     const QString relativeFileName = QFileInfo(rawRelativeFileName).fileName();
@@ -819,6 +1444,40 @@ std::shared_ptr<TextureInfo> Loader::loadTexture(const ofbx::Texture* rawTexture
                           .arg(rawRelativeFileName, fileName).arg(meshIndex).arg(materialIndex).arg(textureTypeStr));
     }
 
+    reference.fileName = fileName;
+
+    return resolveTexture(reference);
+}
+
+std::shared_ptr<TextureInfo> Loader::resolveTexture(const ModelCache::TextureReference& reference)
+{
+    // the notes depend on files next to the model, so they are not stored in the model cache
+    const int noteCount = fileInfo.notes.count();
+
+    std::shared_ptr<TextureInfo> texture;
+    if (reference.isEmbedded())
+    {
+        ofbx::DataView embeddedData;
+        embeddedData.begin = reinterpret_cast<const ofbx::u8*>(fileData.constData()) + reference.embeddedOffset;
+        embeddedData.end = embeddedData.begin + reference.embeddedSize;
+
+        texture = loadEmbeddedTexture(reference.name, embeddedData, reference.meshIndex, reference.materialIndex, reference.typeStr);
+    }
+    else
+    {
+        texture = loadTextureFile(reference.fileName, reference.meshIndex, reference.materialIndex, reference.typeStr);
+    }
+
+    for (int i = noteCount; i < fileInfo.notes.count(); ++i)
+    {
+        textureNotes.append(i);
+    }
+
+    return texture;
+}
+
+std::shared_ptr<TextureInfo> Loader::loadTextureFile(const QString& fileName, const int meshIndex, const int materialIndex, const QString& textureTypeStr)
+{
     const QFileInfo fileInfo(fileName);
     if (!fileInfo.exists())
     {
@@ -836,7 +1495,8 @@ std::shared_ptr<TextureInfo> Loader::loadTexture(const ofbx::Texture* rawTexture
         return nullptr;
     }
 
-    auto& storage = DataStorage::getInstance();
+    // another loader may look for the same texture at the same time
+    QMutexLocker locker(&storage.mutex);
 
     const auto it = storage.textures.find(fileName);
     if (it != storage.textures.end())
@@ -844,24 +1504,478 @@ std::shared_ptr<TextureInfo> Loader::loadTexture(const ofbx::Texture* rawTexture
         return it->second;
     }
 
-    QImage image(fileName);
-    if (image.isNull())
+    // decoding overlaps loading of meshes, images are joined in joinTextures()
+    const QString cacheDirectory = config.textureCacheDirectory;
+    const QFuture<TextureImage> decoding = QtConcurrent::run(QThreadPool::globalInstance(), [fileName, cacheDirectory]()
     {
-        addNote(Note::Type::Error, QTranslator::tr("Failed to open image \"%1\". Mesh %2, material %3, texture %4")
-                          .arg(fileName).arg(meshIndex).arg(materialIndex).arg(textureTypeStr));
-        qCritical() << Q_FUNC_INFO << "failed to open image" << fileName << ". Mesh " << meshIndex << ", material" << materialIndex << ", texture" << textureTypeStr;
+        return TextureCache::load(fileName, cacheDirectory);
+    });
+
+    std::shared_ptr<TextureInfo> texture = std::shared_ptr<TextureInfo>(new TextureInfo(decoding, fileName));
+    storage.textures[fileName] = texture;
+
+    PendingTexture pending;
+    pending.texture = texture;
+    pending.storageKey = fileName;
+    pending.typeStr = textureTypeStr;
+    pending.meshIndex = meshIndex;
+    pending.materialIndex = materialIndex;
+    pendingTextures.append(pending);
+
+    return texture;
+}
+
+std::shared_ptr<TextureInfo> Loader::loadEmbeddedTexture(const QString& name, const ofbx::DataView& embeddedData, const int meshIndex, const int materialIndex, const QString& textureTypeStr)
+{
+    const QByteArray content = getEmbeddedContent(embeddedData);
+    if (content.isEmpty())
+    {
+        addNote(Note::Type::Error, QTranslator::tr("Empty embedded texture. Mesh %1, material %2, texture %3")
+                          .arg(meshIndex).arg(materialIndex).arg(textureTypeStr));
+        qCritical() << Q_FUNC_INFO << "empty embedded texture. Mesh " << meshIndex << ", material" << materialIndex << ", texture" << textureTypeStr;
         return nullptr;
     }
 
-    std::shared_ptr<TextureInfo> texture = std::shared_ptr<TextureInfo>(new TextureInfo(image, fileName));
-    storage.textures[fileName] = texture;
+    // the same image is often embedded once per material or once per file of a pack
+    const QByteArray contentHash = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+    const QString storageKey = "embedded:" + QString::fromLatin1(contentHash.toHex());
 
-    addNote(Note::Type::Info, QTranslator::tr("Opened %1 texture \"%2\". Mesh %3, material %4, texture %5")
-                      .arg(textureTypeStr, fileName).arg(meshIndex).arg(materialIndex).arg(textureTypeStr));
+    // another loader may look for the same texture at the same time
+    QMutexLocker locker(&storage.mutex);
+
+    const auto it = storage.textures.find(storageKey);
+    if (it != storage.textures.end())
+    {
+        return it->second;
+    }
+
+    // content points into fileData, the copy of fileData keeps it alive until the image is decoded
+    const QByteArray owner = fileData;
+    const QString cacheDirectory = config.textureCacheDirectory;
+    const QFuture<TextureImage> decoding = QtConcurrent::run(QThreadPool::globalInstance(), [content, contentHash, cacheDirectory, owner]()
+    {
+        return TextureCache::loadFromData(content, contentHash, cacheDirectory);
+    });
+
+    std::shared_ptr<TextureInfo> texture = std::shared_ptr<TextureInfo>(new TextureInfo(decoding, name.isEmpty() ? storageKey : name));
+    storage.textures[storageKey] = texture;
+
+    PendingTexture pending;
+    pending.texture = texture;
+    pending.storageKey = storageKey;
+    pending.typeStr = textureTypeStr;
+    pending.meshIndex = meshIndex;
+    pending.materialIndex = materialIndex;
+    pendingTextures.append(pending);
 
     return texture;
 }
 
+QByteArray Loader::getEmbeddedContent(const ofbx::DataView& dataView)
+{
+    const char* begin = reinterpret_cast<const char*>(dataView.begin);
+    const int size = int(dataView.end - dataView.begin);
+
+    // binary files store the length of the bytes before them
+    if (size > 4 && qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(begin)) == quint32(size - 4))
+    {
+        return QByteArray::fromRawData(begin + 4, size - 4);
+    }
+
+    // text files store base64
+    QByteArray text = QByteArray(begin, size).trimmed();
+    if (text.size() >= 2 && text.startsWith('"') && text.endsWith('"'))
+    {
+        text = text.mid(1, text.size() - 2);
+    }
+
+    return QByteArray::fromBase64(text);
+}
+
+void Loader::joinTextures()
+{
+    for (const PendingTexture& pending : qAsConst(pendingTextures))
+    {
+        const QString fileName = pending.texture->getFileName();
+
+        if (pending.texture->waitForImage())
+        {
+            fileInfo.statistics.textureBytes += pending.texture->getImageSize();
+            addNote(Note::Type::Info, QTranslator::tr("Opened %1 texture \"%2\". Mesh %3, material %4, texture %5")
+                              .arg(pending.typeStr, fileName).arg(pending.meshIndex).arg(pending.materialIndex).arg(pending.typeStr));
+            continue;
+        }
+
+        addNote(Note::Type::Error, QTranslator::tr("Failed to open image \"%1\". Mesh %2, material %3, texture %4")
+                          .arg(fileName).arg(pending.meshIndex).arg(pending.materialIndex).arg(pending.typeStr));
+        qCritical() << Q_FUNC_INFO << "failed to open image" << fileName << ". Mesh " << pending.meshIndex << ", material" << pending.materialIndex << ", texture" << pending.typeStr;
+
+        {
+            QMutexLocker locker(&storage.mutex);
+            const auto it = storage.textures.find(pending.storageKey);
+            if (it != storage.textures.end() && it->second == pending.texture)
+            {
+                storage.textures.erase(it);
+            }
+        }
+
+        // materials without a texture are drawn with the diffuse color
+        for (const std::shared_ptr<Model>& model : qAsConst(fileInfo.allModels))
+        {
+            const std::shared_ptr<Material>& material = model->data->material;
+            if (material && material->diffuseTexture == pending.texture)
+            {
+                material->diffuseTexture = nullptr;
+            }
+        }
+    }
+
+    pendingTextures.clear();
+}
+
+bool Loader::openFromModelCache(const QByteArray& contentHash)
+{
+    const QString entryFileName = ModelCache::getEntryFileName(fileInfo.absoluteFileName, config.modelCacheDirectory);
+
+    QVector<ModelCache::TextureReference> references;
+    if (!ModelCache::read(entryFileName, contentHash, ModelCache::getConfigHash(config), fileData.size(), fileInfo, references))
+    {
+        return false;
+    }
+
+    PhaseTimer timer(fileInfo.statistics.textures);
+    for (const ModelCache::TextureReference& reference : qAsConst(references))
+    {
+        if (reference.isEmbedded() && reference.embeddedOffset + reference.embeddedSize > fileData.size())
+        {
+            qCritical() << Q_FUNC_INFO << "embedded texture is out of the file";
+            continue;
+        }
+
+        reference.material->diffuseTexture = resolveTexture(reference);
+    }
+
+    addNote(Note::Type::Info, QTranslator::tr("Opened from the model cache"));
+
+    return true;
+}
+
+void Loader::writeModelCache(const QByteArray& contentHash)
+{
+    if (!cacheable || fileInfo.allModels.isEmpty())
+    {
+        return;
+    }
+
+    QList<Note> notes;
+    for (int i = 0; i < fileInfo.notes.count(); ++i)
+    {
+        if (!textureNotes.contains(i))
+        {
+            notes.append(fileInfo.notes[i]);
+        }
+    }
+
+    const QString entryFileName = ModelCache::getEntryFileName(fileInfo.absoluteFileName, config.modelCacheDirectory);
+    if (!ModelCache::write(entryFileName, contentHash, ModelCache::getConfigHash(config), fileData.size(), fileInfo, notes, textureReferences))
+    {
+        qWarning() << Q_FUNC_INFO << "failed to write cache entry" << entryFileName;
+    }
+}
+
+void Loader::collectStatistics()
+{
+    LoadStatistics& statistics = fileInfo.statistics;
+
+    for (const std::shared_ptr<Model>& model : qAsConst(fileInfo.allModels))
+    {
+        const ModelData& data = *model->data;
+        statistics.vertexCount += data.vertexCount;
+        statistics.indexCount += data.indexCount;
+        statistics.vertexBytes += qint64(data.vertexCount) * data.vertexStride;
+        statistics.indexBytes += qint64(data.indexCount) * data.indexStride;
+    }
+
+    statistics.estimatedPeakBytes = qMax(statistics.estimatedPeakBytes, statistics.bytesRead + statistics.vertexBytes + statistics.indexBytes + statistics.textureBytes);
+}
+
+void Loader::loadAnimations(const ofbx::IScene* scene)
+{
+    const int stackCount = scene->getAnimationStackCount();
+    for (int stackIndex = 0; stackIndex < stackCount; ++stackIndex)
+    {
+        const ofbx::AnimationStack* stack = scene->getAnimationStack(stackIndex);
+        if (!stack)
+        {
+            addNote(Note::Type::Error, QTranslator::tr("Internal error"));
+            qCritical() << Q_FUNC_INFO << "animation stack is null, stack index =" << stackIndex;
+            continue;
+        }
+
+        if (!stack->getLayer(0))
+        {
+            addNote(Note::Type::Warning, QTranslator::tr("No layers in animation stack \"%1\"").arg(stack->name));
+            qWarning() << Q_FUNC_INFO << "no layers in animation stack" << stack->name;
+            continue;
+        }
+
+        // Every layer becomes a separate clip, they are combined at runtime with Pose
+        for (int layerIndex = 0; stack->getLayer(layerIndex); ++layerIndex)
+        {
+            std::shared_ptr<AnimationClip> clip = loadAnimationClip(scene, stack, stack->getLayer(layerIndex), stackIndex, layerIndex);
+            if (clip)
+            {
+                fileInfo.animationClips.append(clip);
+            }
+        }
+    }
+}
+
+std::shared_ptr<AnimationClip> Loader::loadAnimationClip(const ofbx::IScene* scene, const ofbx::AnimationStack* stack, const ofbx::AnimationLayer* layer, const int stackIndex, const int layerIndex)
+{
+    static const double DefaultFrameRate = 30.0;
+
+    LayerSampler sampler(*layer);
+
+    QVector<const JointBinding*> animatedJoints;
+    for (const JointBinding& binding : qAsConst(jointBindings))
+    {
+        if (binding.joint && sampler.isAnimated(binding.object))
+        {
+            animatedJoints.append(&binding);
+        }
+    }
+
+    QVector<QPair<const ofbx::Object*, std::shared_ptr<Model>>> animatedModels;
+    if (config.loadTransform)
+    {
+        for (auto it = modelsByObjects.constBegin(); it != modelsByObjects.constEnd(); ++it)
+        {
+            if (sampler.isAnimated(it.key()))
+            {
+                animatedModels.append(QPair<const ofbx::Object*, std::shared_ptr<Model>>(it.key(), it.value()));
+            }
+        }
+    }
+
+    if (animatedJoints.isEmpty() && animatedModels.isEmpty())
+    {
+        addNote(Note::Type::Info, QTranslator::tr("Animation stack \"%1\" does not animate loaded joints or models").arg(stack->name));
+        return nullptr;
+    }
+
+    double frameRate = scene->getSceneFrameRate();
+    if (frameRate <= 0)
+    {
+        frameRate = DefaultFrameRate;
+    }
+
+    double timeFrom = 0;
+    double timeTo = 0;
+
+    const ofbx::TakeInfo* takeInfo = scene->getTakeInfo(stack->name);
+    if (takeInfo && takeInfo->local_time_to > takeInfo->local_time_from)
+    {
+        timeFrom = takeInfo->local_time_from;
+        timeTo = takeInfo->local_time_to;
+    }
+    else if (scene->getGlobalSettings() && scene->getGlobalSettings()->TimeSpanStop > scene->getGlobalSettings()->TimeSpanStart)
+    {
+        timeFrom = scene->getGlobalSettings()->TimeSpanStart;
+        timeTo = scene->getGlobalSettings()->TimeSpanStop;
+    }
+    else
+    {
+        timeFrom = std::numeric_limits<double>::max();
+        timeTo = std::numeric_limits<double>::lowest();
+
+        for (const JointBinding* binding : qAsConst(animatedJoints))
+        {
+            sampler.collectTimeRange(binding->object, timeFrom, timeTo);
+        }
+
+        for (const auto& pair : qAsConst(animatedModels))
+        {
+            sampler.collectTimeRange(pair.first, timeFrom, timeTo);
+        }
+
+        if (timeTo < timeFrom)
+        {
+            timeFrom = timeTo = 0;
+        }
+    }
+
+    const int frameCount = qFloor((timeTo - timeFrom) * frameRate + 0.5) + 1;
+
+    QString name = QString(stack->name);
+    if (name.isEmpty())
+    {
+        name = QTranslator::tr("Animation %1").arg(stackIndex);
+    }
+
+    if (layerIndex > 0)
+    {
+        const QString layerName = QString(layer->name).isEmpty() ? QString::number(layerIndex) : QString(layer->name);
+        name = QTranslator::tr("%1, layer %2").arg(name, layerName);
+    }
+
+    QVector<AnimationTrack> tracks(animatedJoints.count() + animatedModels.count());
+    QVector<std::weak_ptr<Armature>> armatures;
+    QVector<int> trackArmatures(tracks.count(), -1);
+
+    for (int i = 0; i < animatedJoints.count(); ++i)
+    {
+        const std::shared_ptr<Joint>& joint = animatedJoints[i]->joint;
+        tracks[i].joint = joint;
+
+        const std::shared_ptr<Armature> armature = joint->armature.lock();
+        int armatureIndex = -1;
+        for (int j = 0; j < armatures.count(); ++j)
+        {
+            if (armatures[j].lock() == armature)
+            {
+                armatureIndex = j;
+                break;
+            }
+        }
+
+        if (armatureIndex == -1)
+        {
+            armatureIndex = armatures.count();
+            armatures.append(armature);
+        }
+
+        trackArmatures[i] = armatureIndex;
+    }
+
+    for (int i = 0; i < animatedModels.count(); ++i)
+    {
+        tracks[animatedJoints.count() + i].model = animatedModels[i].second;
+    }
+
+    std::shared_ptr<AnimationClip> clip = std::shared_ptr<AnimationClip>(new AnimationClip(name, frameRate, frameCount, tracks));
+    clip->layerIndex = layerIndex;
+    clip->armatures = armatures;
+    clip->trackArmatures = trackArmatures;
+
+    QVector<QMatrix4x4> inverseBindModelMatrices;
+    QVector<int> parentModelTracks;
+    for (int i = 0; i < animatedModels.count(); ++i)
+    {
+        const ofbx::Object* object = animatedModels[i].first;
+        const std::shared_ptr<Model>& model = animatedModels[i].second;
+
+        inverseBindModelMatrices.append((getAxisMatrix() * convertMatrix4x4(object->getGlobalTransform())).inverted());
+
+        int parentTrack = -1;
+        const std::shared_ptr<Model> parent = model->parent.lock();
+        for (int j = 0; j < animatedModels.count(); ++j)
+        {
+            if (parent && animatedModels[j].second == parent)
+            {
+                parentTrack = j;
+                break;
+            }
+        }
+
+        parentModelTracks.append(parentTrack);
+    }
+
+    const QMatrix4x4 axisMatrix = getAxisMatrix();
+    QVector<QMatrix4x4> modelWorldDeltas(animatedModels.count());
+
+    QVector3D translation;
+    QQuaternion rotation;
+    QVector3D scale;
+
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        const double time = timeFrom + frame / frameRate;
+
+        // Joint transforms are applied in the space of the bind pose:
+        // palette = parent palette * source^-1 * transform * source, so
+        // transform = parent link * parent global^-1 * global * link^-1
+        for (int i = 0; i < animatedJoints.count(); ++i)
+        {
+            const JointBinding& binding = *animatedJoints[i];
+
+            QMatrix4x4 matrix = sampler.getGlobalMatrix(binding.object, time) * binding.inverseLinkMatrix;
+            if (binding.parentObject)
+            {
+                matrix = binding.parentLinkMatrix * sampler.getGlobalMatrix(binding.parentObject, time).inverted() * matrix;
+            }
+
+            decomposeMatrix(matrix, translation, rotation, scale);
+            clip->setKey(frame, i, translation, rotation, scale);
+        }
+
+        // Model transforms are applied on top of the bind global transform:
+        // world = parent transforms * transform * source
+        for (int i = 0; i < animatedModels.count(); ++i)
+        {
+            modelWorldDeltas[i] = axisMatrix * sampler.getGlobalMatrix(animatedModels[i].first, time) * inverseBindModelMatrices[i];
+        }
+
+        for (int i = 0; i < animatedModels.count(); ++i)
+        {
+            QMatrix4x4 matrix = modelWorldDeltas[i];
+            if (parentModelTracks[i] != -1)
+            {
+                matrix = modelWorldDeltas[parentModelTracks[i]].inverted() * matrix;
+            }
+
+            decomposeMatrix(matrix, translation, rotation, scale);
+            clip->setKey(frame, animatedJoints.count() + i, translation, rotation, scale);
+        }
+    }
+
+    const qint64 uncompressedSize = clip->getKeysSize();
+    if (config.compressAnimation)
+    {
+        const int rawChannelCount = clip->compress(config.animationTranslationTolerance, config.animationRotationTolerance, config.animationScaleTolerance);
+        if (rawChannelCount > 0)
+        {
+            addNote(Note::Type::Info, QTranslator::tr("Animation \"%1\": %2 channel(s) kept at full precision, quantization exceeds the tolerance")
+                    .arg(name).arg(rawChannelCount));
+        }
+    }
+
+    addNote(Note::Type::Info, QTranslator::tr("Loaded animation \"%1\": %2 frame(s) at %3 fps, %4 track(s), keys %5 KB (uncompressed %6 KB)")
+            .arg(name).arg(frameCount).arg(frameRate).arg(clip->tracks.count())
+            .arg(clip->getKeysSize() / 1024).arg(uncompressedSize / 1024));
+
+    return clip;
+}
+
+QMatrix4x4 Loader::getAxisMatrix() const
+{
+    QMatrix4x4 matrix;
+
+    switch (upDirection)
+    {
+    case ofbxqt::ModelData::AxisDirection::XPlus:
+        matrix.rotate(90, QVector3D(0, 1, 0));
+        break;
+    case ofbxqt::ModelData::AxisDirection::XMinus:
+        matrix.rotate(90, QVector3D(0, -1, 0));
+        break;
+    case ofbxqt::ModelData::AxisDirection::YPlus:
+        matrix.rotate(90, QVector3D(1, 0, 0));
+        break;
+    case ofbxqt::ModelData::AxisDirection::YMinus:
+        matrix.rotate(90, QVector3D(-1, 0, 0));
+        break;
+    case ofbxqt::ModelData::AxisDirection::ZPlus:
+        matrix.scale(1, 1, 1);
+        break;
+    case ofbxqt::ModelData::AxisDirection::ZMinus:
+        matrix.scale(1, 1, -1);
+        break;
+    }
+
+    return matrix;
+}
+
 void Loader::addVertexAttributeGLfloat(ModelData& data, const QString &nameForShader, const int tupleSize)
 {
     int offset = 0;
@@ -2,47 +2,141 @@
 
 #include "openfbxqt.h"
 #include "model.h"
+#include "animation.h"
 #include "datastorage.h"
+#include "modelcache.h"
 #include "OpenFBX/src/ofbx.h"
 #include <QString>
 
 namespace ofbxqt
 {
 
+class LoadTask;
+
+// Wall and processor time of a phase of loading. Processor time is of the loading thread, so other files
+// loaded at the same time do not add to it and textures decoded in the background are not counted
+struct PhaseTime
+{
+    double wallMs = 0;
+    double cpuMs = 0;
+};
+
+struct LoadStatistics
+{
+    PhaseTime total;
+    PhaseTime read; // of the file and of the model cache entry
+    PhaseTime tokenize;
+    PhaseTime inflate; // part of objects and geometry, arrays are inflated when they are parsed
+    PhaseTime objects; // the rest of parsing without geometry
+    PhaseTime geometry;
+    PhaseTime meshes; // vertex and index data, without skin and materials
+    PhaseTime skin;
+    PhaseTime materials; // without textures
+    PhaseTime textures; // including waiting for images decoded in the background
+    PhaseTime animations;
+
+    bool fromModelCache = false;
+    qint64 bytesRead = 0;
+    qint64 compressedBytes = 0;
+    qint64 inflatedBytes = 0;
+    qint64 arenaBytes = 0; // tokens and objects of the OpenFBX scene
+    // Estimate of the most memory held at once, summed from the sizes of the file, the OpenFBX scene with inflated
+    // arrays and the loaded data. Not a measured heap peak, allocator overhead and temporaries are not counted
+    qint64 estimatedPeakBytes = 0;
+    qint64 vertexCount = 0;
+    qint64 indexCount = 0;
+    qint64 vertexBytes = 0;
+    qint64 indexBytes = 0;
+    qint64 textureBytes = 0; // images decoded by this load with mip levels
+};
+
 struct FileInfo
 {
     QString absoluteFileName;
     QString fileName;
     QVector<std::shared_ptr<Model>> topLevelModels;
     QVector<std::shared_ptr<Model>> allModels;
+    QVector<std::shared_ptr<AnimationClip>> animationClips;
     QList<Note> notes;
+    LoadStatistics statistics;
 };
 
+// Loaders are independent, several files can be opened at once from different threads
 class Loader
 {
+    friend class LoaderBenchmark;
+
 public:
+    // Without a storage the loader keeps its own, so nothing outlives the returned FileInfo. Loaders given
+    // the same storage share textures between files
     Loader();
+    explicit Loader(DataStorage& storage);
 
-    FileInfo open(const QString& fileName, const OpenModelConfig config = OpenModelConfig());
+    // Progress is reported to the task if it is set, loading stops early when the task is canceled
+    FileInfo open(const QString& fileName, const OpenModelConfig config = OpenModelConfig(), LoadTask* task = nullptr);
 
 private:
+    void openFile(const QString& fileName);
     void addNote(const Note::Type type, const QString& text);
+    bool checkCanceled();
 
     std::shared_ptr<Model> loadMesh(const ofbx::Mesh* mesh, const int meshIndex, const QString& absoluteDirectoryPath);
     void loadJoints(const ofbx::Skin* skin, ModelData& data, QHash<GLuint, QVector<QPair<GLuint, GLfloat>>>& resultJointsData /*QHash<index of vertex, QVector<QPair<joint index, joint weight>>>*/);
+    void loadMorphTargets(const ofbx::Geometry* geometry, ModelData& data, QVector<QPair<int, int>>& vertexRanges /*QVector<QPair<first entry, entry count>>*/, const int meshIndex);
     void loadMaterial(const ofbx::Material* rawMaterial, std::shared_ptr<Material> material, const int meshIndex, const int materialIndex, const QString& absoluteDirectoryPath);
-    std::shared_ptr<TextureInfo> loadTexture(const ofbx::Texture* rawTexture, const QString& absoluteDirectoryPath, const int meshIndex, const int materialIndex, ofbx::Texture::TextureType type);
+    std::shared_ptr<TextureInfo> loadTexture(const ofbx::Texture* rawTexture, const QString& absoluteDirectoryPath, const int meshIndex, const int materialIndex, ofbx::Texture::TextureType type, ModelCache::TextureReference& reference);
+    std::shared_ptr<TextureInfo> resolveTexture(const ModelCache::TextureReference& reference);
+    std::shared_ptr<TextureInfo> loadTextureFile(const QString& fileName, const int meshIndex, const int materialIndex, const QString& textureTypeStr);
+    std::shared_ptr<TextureInfo> loadEmbeddedTexture(const QString& name, const ofbx::DataView& embeddedData, const int meshIndex, const int materialIndex, const QString& textureTypeStr);
+    static QByteArray getEmbeddedContent(const ofbx::DataView& dataView);
+    void joinTextures();
+    bool openFromModelCache(const QByteArray& contentHash);
+    void writeModelCache(const QByteArray& contentHash);
+    void collectStatistics();
+    void loadAnimations(const ofbx::IScene* scene);
+    std::shared_ptr<AnimationClip> loadAnimationClip(const ofbx::IScene* scene, const ofbx::AnimationStack* stack, const ofbx::AnimationLayer* layer, const int stackIndex, const int layerIndex);
+
+    QMatrix4x4 getAxisMatrix() const;
 
     void addVertexAttributeGLfloat(ModelData& modelData, const QString& nameForShader, const int tupleSize);
     void convertAxisDirection(ModelData::AxisDirection& value, const int axis, const int sign);
 
+    DataStorage ownStorage;
+    DataStorage& storage;
+
     OpenModelConfig config;
+    LoadTask* task = nullptr;
+    QByteArray fileData; // referenced by the ofbx scene and by embedded textures
 
     FileInfo fileInfo;
     ModelData::AxisDirection upDirection = ModelData::DefaultUpDirection;
     ModelData::AxisDirection forwardDirection = ModelData::DefaultForwardDirection;
 
-    static DataStorage dataStorage;
+    struct JointBinding
+    {
+        std::shared_ptr<Joint> joint;
+        const ofbx::Object* object = nullptr;
+        const ofbx::Object* parentObject = nullptr; // object of the parent joint
+        QMatrix4x4 inverseLinkMatrix; // inverted global matrix of the joint at bind time
+        QMatrix4x4 parentLinkMatrix; // global matrix of the parent joint at bind time
+    };
+
+    // Textures decoded in the background, joined at the end of open()
+    struct PendingTexture
+    {
+        std::shared_ptr<TextureInfo> texture;
+        QString storageKey; // in DataStorage::textures
+        QString typeStr;
+        int meshIndex = -1;
+        int materialIndex = -1;
+    };
+
+    QVector<PendingTexture> pendingTextures;
+    QVector<ModelCache::TextureReference> textureReferences;
+    QVector<int> textureNotes; // indexes of notes emitted again when textures are resolved from the model cache
+    bool cacheable = true;
+    QVector<JointBinding> jointBindings;
+    QHash<const ofbx::Object*, std::shared_ptr<Model>> modelsByObjects;
 };
 
 }
@@ -0,0 +1,103 @@
+#include "loadtask.h"
+
+namespace ofbxqt
+{
+
+QString LoadTask::phaseToString(const Phase phase)
+{
+    switch (phase)
+    {
+    case Phase::Queued: return QTranslator::tr("Queued");
+    case Phase::Reading: return QTranslator::tr("Reading file");
+    case Phase::Parsing: return QTranslator::tr("Parsing");
+    case Phase::Meshes: return QTranslator::tr("Loading meshes");
+    case Phase::Animations: return QTranslator::tr("Loading animations");
+    case Phase::Finished: return QTranslator::tr("Finished");
+    case Phase::Canceled: return QTranslator::tr("Canceled");
+    }
+
+    qCritical() << Q_FUNC_INFO << "unknown phase" << (int)phase;
+
+    return "<UNKNOWN>";
+}
+
+double LoadTask::getProgress() const
+{
+    // rough shares of the phases in the loading time
+    static const double ReadingEnd = 0.3;
+    static const double ParsingEnd = 0.5;
+    static const double MeshesEnd = 0.9;
+
+    switch (getPhase())
+    {
+    case Phase::Queued:
+        return 0;
+    case Phase::Reading:
+    {
+        const qint64 total = getTotalBytes();
+        return total > 0 ? ReadingEnd * getBytesRead() / total : 0;
+    }
+    case Phase::Parsing:
+        return ReadingEnd;
+    case Phase::Meshes:
+    {
+        const int total = getItemsTotal();
+        return ParsingEnd + (total > 0 ? (MeshesEnd - ParsingEnd) * getItemsDone() / total : 0);
+    }
+    case Phase::Animations:
+        return MeshesEnd;
+    case Phase::Finished:
+    case Phase::Canceled:
+        return 1;
+    }
+
+    return 0;
+}
+
+bool LoadTask::isFinished() const
+{
+    const Phase phase_ = getPhase();
+    return phase_ == Phase::Finished || phase_ == Phase::Canceled;
+}
+
+void LoadTask::waitForFinished() const
+{
+    QMutexLocker locker(&mutex);
+    while (!isFinished())
+    {
+        finishedCondition.wait(&mutex);
+    }
+}
+
+FileInfo LoadTask::getFileInfo() const
+{
+    QMutexLocker locker(&mutex);
+    return fileInfo;
+}
+
+void LoadTask::setPhase(const Phase phase_)
+{
+    phase.storeRelease(int(phase_));
+}
+
+void LoadTask::setBytes(const qint64 read, const qint64 total)
+{
+    totalBytes.storeRelease(total);
+    bytesRead.storeRelease(read);
+}
+
+void LoadTask::setItems(const int done, const int total)
+{
+    itemsTotal.storeRelease(total);
+    itemsDone.storeRelease(done);
+}
+
+void LoadTask::finish(const FileInfo& fileInfo_)
+{
+    QMutexLocker locker(&mutex);
+    fileInfo = fileInfo_;
+    setPhase(isCancelRequested() ? Phase::Canceled : Phase::Finished);
+    finishedCondition.wakeAll();
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "loader.h"
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace ofbxqt
+{
+
+// Progress and result of Scene::openAsync(). Written by the loader thread, may be read from any thread
+class LoadTask
+{
+public:
+    friend class Loader;
+    friend class Scene;
+
+    enum class Phase { Queued, Reading, Parsing, Meshes, Animations, Finished, Canceled };
+
+    Phase getPhase() const { return Phase(phase.loadAcquire()); }
+    static QString phaseToString(const Phase phase);
+
+    qint64 getBytesRead() const { return bytesRead.loadAcquire(); }
+    qint64 getTotalBytes() const { return totalBytes.loadAcquire(); }
+    int getItemsDone() const { return itemsDone.loadAcquire(); }
+    int getItemsTotal() const { return itemsTotal.loadAcquire(); }
+
+    // Estimation of the whole work from 0 to 1
+    double getProgress() const;
+
+    // Parsing of the file itself can not be interrupted, the task stops after the current phase or mesh
+    void cancel() { cancelRequested.storeRelease(1); }
+    bool isCancelRequested() const { return cancelRequested.loadAcquire() != 0; }
+
+    bool isFinished() const;
+    void waitForFinished() const;
+
+    // Valid after the task is finished
+    FileInfo getFileInfo() const;
+
+private:
+    void setPhase(const Phase phase);
+    void setBytes(const qint64 read, const qint64 total);
+    void setItems(const int done, const int total);
+    void finish(const FileInfo& fileInfo);
+
+    QAtomicInt phase = int(Phase::Queued);
+    QAtomicInteger<qint64> bytesRead = 0;
+    QAtomicInteger<qint64> totalBytes = 0;
+    QAtomicInt itemsDone = 0;
+    QAtomicInt itemsTotal = 0;
+    QAtomicInt cancelRequested = 0;
+
+    mutable QMutex mutex;
+    mutable QWaitCondition finishedCondition;
+    FileInfo fileInfo;
+};
+
+}
@@ -1,37 +1,152 @@
 #include "material.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
 
 namespace ofbxqt
 {
 
 TextureInfo::TextureInfo(const QImage &image_, const QString &fileName_)
-    : image(image_)
+    : image(TextureImage::fromImage(image_))
     , fileName(fileName_)
 {
 
 }
 
+TextureInfo::TextureInfo(const QFuture<TextureImage>& decoding_, const QString& fileName_)
+    : fileName(fileName_)
+    , decoding(decoding_)
+    , decodingPending(true)
+{
+
+}
+
+bool TextureInfo::waitForImage()
+{
+    QMutexLocker locker(&decodingMutex);
+
+    if (decodingPending)
+    {
+        image = decoding.result();
+        decoding = QFuture<TextureImage>();
+        decodingPending = false;
+    }
+
+    return !image.isNull() || texture;
+}
+
 void TextureInfo::initializeGL()
 {
-    if (texture)
+    UploadBudget budget;
+    uploadGL(budget);
+}
+
+bool TextureInfo::uploadGL(UploadBudget& budget)
+{
+    if (resident)
+    {
+        return true;
+    }
+
+    if (!texture)
+    {
+        if (!waitForImage())
+        {
+            qCritical() << Q_FUNC_INFO << "image is null," << fileName;
+            resident = true;
+            return true;
+        }
+
+        // the image is already flipped and has all mip levels
+        gpuSize = image.getSizeInBytes();
+        texture = std::make_shared<QOpenGLTexture>(QOpenGLTexture::Target2D);
+        texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+        texture->setSize(image.getWidth(), image.getHeight());
+        texture->setMipLevels(image.getLevelCount());
+        texture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+
+        uploadedLevel = 0;
+        uploadedRows = 0;
+    }
+
+    QOpenGLFunctions* functions = QOpenGLContext::currentContext()->functions();
+
+    while (uploadedLevel < image.getLevelCount())
+    {
+        const int width = image.getWidth(uploadedLevel);
+        const int height = image.getHeight(uploadedLevel);
+        const qint64 bytesPerLine = qint64(width) * 4;
+
+        while (uploadedRows < height)
+        {
+            if (budget.isExhausted())
+            {
+                return false;
+            }
+
+            const int rows = int(budget.take((height - uploadedRows) * bytesPerLine, bytesPerLine) / bytesPerLine);
+
+            // RGBA8 rows are 4-byte aligned, as the default unpack alignment expects
+            texture->bind();
+            functions->glTexSubImage2D(GL_TEXTURE_2D, uploadedLevel, 0, uploadedRows, width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                                       image.getLevelData(uploadedLevel) + uploadedRows * bytesPerLine);
+            texture->release();
+
+            uploadedRows += rows;
+        }
+
+        ++uploadedLevel;
+        uploadedRows = 0;
+    }
+
+    if (!keepCpuData)
+    {
+        image = TextureImage();
+    }
+
+    resident = true;
+
+    return true;
+}
+
+bool TextureInfo::releaseGL()
+{
+    if (!texture || image.isNull())
     {
-        return;
+        return false;
     }
 
-    texture = std::shared_ptr<QOpenGLTexture>(new QOpenGLTexture(image.mirrored()));
-    image = QImage();
+    texture.reset();
+    uploadedLevel = 0;
+    uploadedRows = 0;
+    resident = false;
+
+    return true;
 }
 
 void Material::initializeGL()
 {
-    if (diffuseTexture)
+    UploadBudget budget;
+    uploadGL(budget);
+}
+
+bool Material::uploadGL(UploadBudget& budget)
+{
+    if (diffuseTexture && !diffuseTexture->uploadGL(budget))
     {
-        diffuseTexture->initializeGL();
+        return false;
     }
 
-    if (normalTexture)
+    if (normalTexture && !normalTexture->uploadGL(budget))
     {
-        normalTexture->initializeGL();
+        return false;
     }
+
+    return true;
+}
+
+bool Material::isResident() const
+{
+    return (!diffuseTexture || diffuseTexture->isResident()) && (!normalTexture || normalTexture->isResident());
 }
 
 }
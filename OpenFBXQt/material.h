@@ -1,6 +1,10 @@
 #pragma once
 
+#include "uploadqueue.h"
+#include "texturecache.h"
+#include <QFuture>
 #include <QImage>
+#include <QMutex>
 #include <QOpenGLTexture>
 #include <memory>
 
@@ -11,16 +15,43 @@ class TextureInfo
 {
 public:
     friend class Model;
+    friend class InstancedModel;
+    friend class ResidencyManager;
+    friend class Scene;
     TextureInfo(const QImage& image, const QString& fileName);
+    // The image is decoded or read from the texture cache in the background
+    TextureInfo(const QFuture<TextureImage>& decoding, const QString& fileName);
+
+    // Blocks until the image is decoded, returns false if it failed. Called before the upload
+    bool waitForImage();
 
     void initializeGL();
+    // Uploads rows of the mip levels within the budget, returns true when the texture is resident
+    bool uploadGL(UploadBudget& budget);
+    bool isResident() const { return resident; }
     QString getFileName() const { return fileName; }
+    // Bytes of the decoded image with mip levels, 0 before it is decoded and after the upload
+    qint64 getImageSize() const { return image.getSizeInBytes(); }
 
 private:
-    QImage image;
+    TextureImage image;
     const QString fileName;
 
+    QMutex decodingMutex;
+    QFuture<TextureImage> decoding;
+    bool decodingPending = false;
+
     std::shared_ptr<QOpenGLTexture> texture;
+    int uploadedLevel = 0;
+    int uploadedRows = 0;
+    bool resident = false;
+
+    // Residency: with a video memory budget the image is kept, so a released texture can be uploaded again
+    bool releaseGL();
+    bool keepCpuData = false;
+    bool residencyTracked = false;
+    quint64 lastUsedFrame = 0;
+    qint64 gpuSize = 0;
 };
 
 class Material
@@ -35,6 +66,8 @@ public:
     std::shared_ptr<TextureInfo> normalTexture;
 
     void initializeGL();
+    bool uploadGL(UploadBudget& budget);
+    bool isResident() const;
 };
 
 }
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+namespace ofbxqt
+{
+
+// Memory of a scene in bytes by asset. An asset shared by several models, materials or files is listed once,
+// users counts what references it. CPU sizes cover the large arrays, not the small objects around them
+struct MemoryReport
+{
+    struct ModelDataEntry
+    {
+        QString name;
+        int users = 0; // models
+        qint64 vertexBytes = 0; // CPU copies, kept until upload or for residency
+        qint64 indexBytes = 0;
+        qint64 morphBytes = 0;
+        qint64 mappedBytes = 0; // vertex and index data read from a mapped model cache entry
+        qint64 gpuVertexBytes = 0;
+        qint64 gpuIndexBytes = 0;
+        qint64 gpuMorphBytes = 0;
+
+        qint64 getCpuBytes() const { return vertexBytes + indexBytes + morphBytes; }
+        qint64 getGpuBytes() const { return gpuVertexBytes + gpuIndexBytes + gpuMorphBytes; }
+    };
+
+    struct TextureEntry
+    {
+        QString fileName;
+        int users = 0; // materials
+        qint64 imageBytes = 0; // decoded image with mip levels, kept until upload or for residency
+        qint64 gpuBytes = 0; // with mip levels
+    };
+
+    struct ArmatureEntry
+    {
+        QString name; // of the first model using it
+        int users = 0; // models
+        int jointCount = 0;
+        qint64 cpuBytes = 0; // joints and evaluation arrays
+    };
+
+    struct AnimationEntry
+    {
+        QString name;
+        int users = 0; // files or instanced models
+        qint64 cpuBytes = 0; // keys of a clip, texels of a baked animation until upload
+        qint64 gpuBytes = 0; // texture of a baked animation
+    };
+
+    QVector<ModelDataEntry> modelData;
+    QVector<TextureEntry> textures;
+    QVector<ArmatureEntry> armatures;
+    QVector<AnimationEntry> animations;
+
+    qint64 morphWeightGpuBytes = 0; // one texture per morphed model
+    qint64 instanceCpuBytes = 0; // per-instance data of instanced models
+    qint64 instanceGpuBytes = 0;
+
+    // Textures kept by DataStorage for sharing between files but not used by the scene:
+    // leftovers of closed models and of files still loading
+    int leftoverCount = 0;
+    qint64 leftoverCpuBytes = 0;
+    qint64 leftoverGpuBytes = 0;
+
+    // Sums of everything above. Mapped model cache entries are counted once each, the system pages them in as needed
+    qint64 cpuBytes = 0;
+    qint64 gpuBytes = 0;
+    qint64 mappedBytes = 0;
+};
+
+}
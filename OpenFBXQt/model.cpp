@@ -1,58 +1,137 @@
 #include "model.h"
 #include <QSceneLoader>
+#include <QFile>
 
 namespace ofbxqt
 {
 
-Model::Model(std::shared_ptr<ModelData> data_)
-    : armature(data_->armature)
-    , data(data_)
+static const int MorphTextureUnit = 2;
+static const int MorphWeightsTextureUnit = 3;
+
+static QByteArray readShaderSource(const QString& fileName, const QByteArray& defines)
 {
-    if (!data)
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
     {
-        qCritical() << Q_FUNC_INFO << "data is null";
+        qCritical() << Q_FUNC_INFO << "failed to open" << fileName;
+        return QByteArray();
     }
+
+    return defines + file.readAll();
 }
 
-void Model::initializeGL()
+// The buffer storage is allocated once, the data is written in chunks by the budget
+static bool uploadBuffer(QOpenGLBuffer& buffer, QByteArray& source, const int size, int& uploadedBytes, const bool keepSource, UploadBudget& budget)
 {
-    if (initializedGL)
+    if (!buffer.isCreated())
     {
-        return;
+        if (!buffer.create())
+        {
+            qCritical() << Q_FUNC_INFO << "failed to create buffer";
+        }
+
+        if (!buffer.bind())
+        {
+            qCritical() << Q_FUNC_INFO << "failed to bind buffer";
+        }
+
+        buffer.allocate(size);
+
+        if (buffer.size() <= 0)
+        {
+            qWarning() << Q_FUNC_INFO << "buffer is empty";
+        }
+
+        buffer.release();
+
+        uploadedBytes = 0;
+
+        if (source.size() < size)
+        {
+            qCritical() << Q_FUNC_INFO << "source has" << source.size() << "bytes, expected" << size;
+            uploadedBytes = size;
+        }
+    }
+
+    while (uploadedBytes < size)
+    {
+        if (budget.isExhausted())
+        {
+            return false;
+        }
+
+        const int chunk = int(budget.take(size - uploadedBytes));
+
+        buffer.bind();
+        buffer.write(uploadedBytes, source.constData() + uploadedBytes, chunk);
+        buffer.release();
+
+        uploadedBytes += chunk;
     }
 
-    initializedGL = true;
+    if (!keepSource)
+    {
+        source.clear();
+    }
 
-    initializeOpenGLFunctions();
+    return true;
+}
 
+Model::Model(std::shared_ptr<ModelData> data_)
+    : armature(data_->armature)
+    , data(data_)
+{
     if (!data)
     {
         qCritical() << Q_FUNC_INFO << "data is null";
         return;
     }
 
-    if (!material)
+    for (const MorphTarget& target : qAsConst(data->morphTargets))
     {
-        material = data->material;
+        morphWeights.append(target.defaultWeight);
     }
+}
 
-    if (material)
+void Model::initializeGL()
+{
+    UploadBudget budget;
+    uploadGL(budget);
+}
+
+bool Model::uploadGL(UploadBudget& budget)
+{
+    if (isResident())
     {
-        material->initializeGL();
+        return true;
     }
 
-    if (!data->vertexBuffer.isCreated())
+    if (!initializedGL)
     {
-        if (!data->vertexBuffer.create())
+        initializedGL = true;
+
+        initializeOpenGLFunctions();
+
+        if (!data)
         {
-            qCritical() << Q_FUNC_INFO << "failed to create vertex buffer";
+            qCritical() << Q_FUNC_INFO << "data is null";
+            resident = true;
+            return true;
         }
 
-        if (!data->vertexBuffer.bind())
+        if (!material)
         {
-            qCritical() << Q_FUNC_INFO << "failed to bind vertex buffer";
+            material = data->material;
         }
+    }
 
+    if (material && !material->uploadGL(budget))
+    {
+        return false;
+    }
+
+    if (!data->vertexBuffer.isCreated())
+    {
         if (data->vertexData.isEmpty())
         {
             qCritical() << Q_FUNC_INFO << "vertex data is empty";
@@ -67,31 +146,15 @@ void Model::initializeGL()
         {
             qCritical() << Q_FUNC_INFO << "vertex stride is" << data->vertexStride;
         }
+    }
 
-        data->vertexBuffer.allocate(data->vertexData, data->vertexCount * data->vertexStride);
-
-        if (data->vertexBuffer.size() <= 0)
-        {
-            qWarning() << Q_FUNC_INFO << "vertex buffer is empty";
-        }
-
-        data->vertexBuffer.release();
-
-        data->vertexData.clear();
+    if (!uploadBuffer(data->vertexBuffer, data->vertexData, data->vertexCount * data->vertexStride, data->vertexBytesUploaded, data->keepCpuData, budget))
+    {
+        return false;
     }
 
     if (!data->indexBuffer.isCreated())
     {
-        if (!data->indexBuffer.create())
-        {
-            qCritical() << Q_FUNC_INFO << "failed to create index buffer";
-        }
-
-        if (!data->indexBuffer.bind())
-        {
-            qCritical() << Q_FUNC_INFO << "failed to bind index buffer";
-        }
-
         if (data->indexData.isEmpty())
         {
             qCritical() << Q_FUNC_INFO << "index data is empty";
@@ -106,21 +169,66 @@ void Model::initializeGL()
         {
             qCritical() << Q_FUNC_INFO << "index stride is" << data->indexStride;
         }
+    }
 
-        data->indexBuffer.allocate(data->indexData, data->indexCount * data->indexStride);
+    if (!uploadBuffer(data->indexBuffer, data->indexData, data->indexCount * data->indexStride, data->indexBytesUploaded, data->keepCpuData, budget))
+    {
+        return false;
+    }
+
+    if (!data->keepCpuData)
+    {
+        data->mappedFile.reset();
+    }
 
-        if (data->indexBuffer.size() <= 0)
+    if (!data->morphTargets.isEmpty() && !data->morphTexture)
+    {
+        if (budget.isExhausted())
         {
-            qWarning() << Q_FUNC_INFO << "index buffer is empty";
+            return false;
         }
 
-        data->indexBuffer.release();
+        budget.consume(qint64(data->morphData.count()) * int(sizeof(float)));
 
-        data->indexData.clear();
+        const int height = data->morphData.count() / (ModelData::MorphTextureWidth * 4);
+
+        data->morphTexture = std::make_shared<QOpenGLTexture>(QOpenGLTexture::Target2D);
+        data->morphTexture->setFormat(QOpenGLTexture::RGBA32F);
+        data->morphTexture->setSize(ModelData::MorphTextureWidth, height);
+        data->morphTexture->setMipLevels(1);
+        data->morphTexture->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+        data->morphTexture->setWrapMode(QOpenGLTexture::ClampToEdge);
+        data->morphTexture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::Float32);
+        data->morphTexture->setData(QOpenGLTexture::RGBA, QOpenGLTexture::Float32, data->morphData.constData());
+
+        if (!data->keepCpuData)
+        {
+            data->morphData.clear();
+        }
     }
 
-    if (!data->shader.isLinked())
+    if (!morphWeights.isEmpty() && !morphWeightsTexture)
     {
+        morphWeightsTexture.reset(new QOpenGLTexture(QOpenGLTexture::Target2D));
+        morphWeightsTexture->setFormat(QOpenGLTexture::R32F);
+        morphWeightsTexture->setSize(morphWeights.count(), 1);
+        morphWeightsTexture->setMipLevels(1);
+        morphWeightsTexture->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+        morphWeightsTexture->setWrapMode(QOpenGLTexture::ClampToEdge);
+        morphWeightsTexture->allocateStorage(QOpenGLTexture::Red, QOpenGLTexture::Float32);
+
+        uploadedMorphWeights.clear();
+        uploadMorphWeights(morphWeights, nullptr);
+    }
+
+    // a shader that failed to link is not built again
+    if (data->shader.shaders().isEmpty())
+    {
+        if (budget.isExhausted())
+        {
+            return false;
+        }
+
         QString vshaderFileName;
         if (data->armature)
         {
@@ -141,7 +249,13 @@ void Model::initializeGL()
             fshaderFileName = ":/OpenFBXQt-shaders/fshader-colored.glsl";
         }
 
-        if (!data->shader.addShaderFromSourceFile(QOpenGLShader::Vertex, vshaderFileName))
+        QByteArray defines;
+        if (!data->morphTargets.isEmpty())
+        {
+            defines += "#define MORPH_TARGETS\n";
+        }
+
+        if (!data->shader.addShaderFromSourceCode(QOpenGLShader::Vertex, readShaderSource(vshaderFileName, defines)))
         {
             qWarning() << Q_FUNC_INFO << "failed to compile vertex shader";
         }
@@ -156,10 +270,20 @@ void Model::initializeGL()
             qWarning() << Q_FUNC_INFO << "failed to link shader";
         }
     }
+
+    resident = true;
+
+    return true;
 }
 
-void Model::paintGL(const QMatrix4x4 &projection)
+void Model::paintGL(const QMatrix4x4 &projection, const QMatrix4x4& worldMatrix, const QMatrix4x4& modelProjectionMatrix, const QMatrix4x4* palette, const int paletteSize, const QVector<float>& morphWeights_, FrameStatistics& statistics)
 {
+    // models are drawn when all their data is uploaded
+    if (!isResident())
+    {
+        return;
+    }
+
     if (!data)
     {
         qCritical() << Q_FUNC_INFO << "data is null";
@@ -181,11 +305,19 @@ void Model::paintGL(const QMatrix4x4 &projection)
 #endif
     }
 
+    // the weights upload binds its own texture, do it before the diffuse texture is bound
+    const bool morphed = data->morphTexture && morphWeightsTexture;
+    if (morphed)
+    {
+        uploadMorphWeights(morphWeights_, &statistics);
+    }
+
     if (material->diffuseTexture)
     {
         if (material->diffuseTexture->texture)
         {
-            material->diffuseTexture->texture->bind();
+            material->diffuseTexture->texture->bind(0);
+            ++statistics.textureBinds;
         }
         else
         {
@@ -202,46 +334,60 @@ void Model::paintGL(const QMatrix4x4 &projection)
 #endif
     }
 
+    ++statistics.shaderBinds;
+
     QVector3D v(0, 0, 0);
-    v = v.unproject(parentMatrix * transform.getResultMatrix() * data->sourceMatrix, projection, QRect(0, 0, 1, 1));
+    v = v.unproject(worldMatrix, projection, QRect(0, 0, 1, 1));
 
-    data->shader.setUniformValue("projection_pos", v);
-    data->shader.setUniformValue("model_projection_matrix", projection * parentMatrix * transform.getResultMatrix() * data->sourceMatrix);
+    setUniform(data->shader, "projection_pos", v, statistics);
+    setUniform(data->shader, "model_projection_matrix", modelProjectionMatrix, statistics);
 
     if (material)
     {
         if (material->diffuseTexture && material->diffuseTexture->texture)
         {
-            data->shader.setUniformValue("texture", 0);
+            setUniform(data->shader, "texture", 0, statistics);
         }
         else if (material->diffuseColor)
         {
-            data->shader.setUniformValue("u_color", *material->diffuseColor);
+            setUniform(data->shader, "u_color", *material->diffuseColor, statistics);
         }
         else
         {
 #ifdef QT_DEBUG
         qCritical() << Q_FUNC_INFO << "diffuse color is null";
 #endif
-        data->shader.setUniformValue("u_color", QColor());
+        setUniform(data->shader, "u_color", QColor(), statistics);
         }
     }
     else
     {
-        data->shader.setUniformValue("u_color", QColor());
+        setUniform(data->shader, "u_color", QColor(), statistics);
     }
 
-    if (armature)
+    if (palette && paletteSize > 0)
     {
-        const QVector<QMatrix4x4>& matrices = armature->jointsMatrices;
-        if (matrices.count() > 0)
-        {
-            data->shader.setUniformValueArray("joints", matrices.data(), matrices.count());
-        }
+        setUniformArray(data->shader, "joints", palette, paletteSize, statistics);
+        statistics.paletteBytes += paletteSize * qint64(sizeof(GLfloat)) * 16;
+    }
+
+    if (morphed)
+    {
+        // the active unit is restored so that later diffuse binds land on unit 0
+        data->morphTexture->bind(MorphTextureUnit, QOpenGLTexture::ResetTextureUnit);
+        ++statistics.textureBinds;
+        morphWeightsTexture->bind(MorphWeightsTextureUnit, QOpenGLTexture::ResetTextureUnit);
+        ++statistics.textureBinds;
+
+        setUniform(data->shader, "morph_texture", MorphTextureUnit, statistics);
+        setUniform(data->shader, "morph_texture_size", QVector2D(data->morphTexture->width(), data->morphTexture->height()), statistics);
+        setUniform(data->shader, "morph_weights", MorphWeightsTextureUnit, statistics);
+        setUniform(data->shader, "morph_weights_size", GLfloat(morphWeightsTexture->width()), statistics);
     }
 
     data->vertexBuffer.bind();
     data->indexBuffer.bind();
+    statistics.bufferBinds += 2;
 
     for (const VertexAttributeInfo& attribute : qAsConst(data->vertexAttributes))
     {
@@ -259,12 +405,20 @@ void Model::paintGL(const QMatrix4x4 &projection)
     }
 
     glDrawElements(data->drawElementsMode, data->indexCount, data->indexType, nullptr);
+    ++statistics.drawCalls;
+    statistics.triangles += data->indexCount / 3;
 
     data->shader.release();
 
     if (material && material->diffuseTexture && material->diffuseTexture->texture)
     {
-        material->diffuseTexture->texture->release();
+        material->diffuseTexture->texture->release(0);
+    }
+
+    if (morphed)
+    {
+        data->morphTexture->release(MorphTextureUnit, QOpenGLTexture::ResetTextureUnit);
+        morphWeightsTexture->release(MorphWeightsTextureUnit, QOpenGLTexture::ResetTextureUnit);
     }
 
     data->vertexBuffer.release();
@@ -282,13 +436,33 @@ QString Model::getName() const
     return data->name;
 }
 
+int Model::getVertexCount() const
+{
+    return data ? data->vertexCount : 0;
+}
+
+int Model::getIndexCount() const
+{
+    return data ? data->indexCount : 0;
+}
+
+std::shared_ptr<Material> Model::getMaterial() const
+{
+    if (material || !data)
+    {
+        return material;
+    }
+
+    return data->material;
+}
+
 void Model::setTransform(const Transform &transform_)
 {
     transform = transform_;
 
     for (const std::shared_ptr<Model>& child : qAsConst(children))
     {
-        child->updateChildrenMatrix(transform.getResultMatrix());
+        child->updateChildrenMatrix(parentMatrix * transform.getResultMatrix());
     }
 }
 
@@ -297,6 +471,135 @@ const Transform &Model::getTransform() const
     return transform;
 }
 
+QMatrix4x4 Model::getWorldMatrix() const
+{
+    if (!data)
+    {
+        qCritical() << Q_FUNC_INFO << "data is null";
+        return parentMatrix * transform.getResultMatrix();
+    }
+
+    QMatrix4x4 matrix = simd::multiply(parentMatrix, transform.getResultMatrix());
+    simd::multiply(matrix.constData(), data->sourceMatrix.constData(), matrix.data());
+    return matrix;
+}
+
+bool Model::isResident() const
+{
+    if (!data)
+    {
+        return resident;
+    }
+
+    // the data and textures may be released by the residency manager and shared with other models
+    return resident && data->isResident() && (!material || material->isResident());
+}
+
+void Model::getBoundingSphere(const QMatrix4x4& matrix, QVector3D& center, float& radius) const
+{
+    if (!data)
+    {
+        qCritical() << Q_FUNC_INFO << "data is null";
+        center = matrix.map(QVector3D());
+        radius = 0;
+        return;
+    }
+
+    center = matrix.map((data->boundsMin + data->boundsMax) * 0.5f);
+
+    const float scale = qMax(qMax(matrix.column(0).toVector3D().length(), matrix.column(1).toVector3D().length()), matrix.column(2).toVector3D().length());
+    radius = (data->boundsMax - data->boundsMin).length() * 0.5f * scale;
+}
+
+QString Model::getMorphTargetName(const int index) const
+{
+    if (!data || index < 0 || index >= data->morphTargets.count())
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return QString();
+    }
+
+    return data->morphTargets[index].name;
+}
+
+int Model::getMorphTargetIndex(const QString& name) const
+{
+    if (!data)
+    {
+        qCritical() << Q_FUNC_INFO << "data is null";
+        return -1;
+    }
+
+    for (int i = 0; i < data->morphTargets.count(); ++i)
+    {
+        if (data->morphTargets[i].name == name)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void Model::setMorphWeight(const int index, const float weight)
+{
+    if (index < 0 || index >= morphWeights.count())
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    morphWeights[index] = weight;
+}
+
+void Model::uploadMorphWeights(const QVector<float>& weights, FrameStatistics* statistics)
+{
+    if (!morphWeightsTexture || weights.count() != morphWeightsTexture->width())
+    {
+        return;
+    }
+
+    // vectors share data while nothing has changed
+    if (weights.constData() == uploadedMorphWeights.constData())
+    {
+        return;
+    }
+
+    int first = 0;
+    int last = weights.count() - 1;
+    if (uploadedMorphWeights.count() == weights.count())
+    {
+        while (first <= last && weights[first] == uploadedMorphWeights[first])
+        {
+            ++first;
+        }
+
+        while (last >= first && weights[last] == uploadedMorphWeights[last])
+        {
+            --last;
+        }
+    }
+
+    uploadedMorphWeights = weights;
+
+    if (first > last)
+    {
+        return;
+    }
+
+    // its own unit, so no texture bound for drawing is replaced
+    morphWeightsTexture->bind(MorphWeightsTextureUnit, QOpenGLTexture::ResetTextureUnit);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, first, 0, last - first + 1, 1, GL_RED, GL_FLOAT, weights.constData() + first);
+
+    if (statistics)
+    {
+        ++statistics->textureBinds;
+        ++statistics->textureUploads;
+    }
+    morphWeightsTexture->release(MorphWeightsTextureUnit, QOpenGLTexture::ResetTextureUnit);
+}
+
 void Model::updateChildrenMatrix(const QMatrix4x4& parentMatrix_)
 {
     parentMatrix = parentMatrix_;
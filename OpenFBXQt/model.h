@@ -3,6 +3,7 @@
 #include "openfbxqt.h"
 #include "armature.h"
 #include "datastorage.h"
+#include "framestatistics.h"
 #include <QColor>
 #include <QOpenGLFunctions>
 
@@ -19,20 +20,52 @@ public:
     QVector<std::shared_ptr<Model>> children;
 
     friend class Loader;
+    friend class InstancedModel;
+    friend class ResidencyManager;
+    friend class ModelCache;
+    friend class Scene;
 
     Model(std::shared_ptr<ModelData> data);
 
     void initializeGL();
-    void paintGL(const QMatrix4x4& projection);
+    // Uploads the next part of the data within the budget, returns true when the model can be drawn
+    bool uploadGL(UploadBudget& budget);
+    bool isResident() const;
+    // Matrices come from a snapshot of the scene, so the model may be changed concurrently.
+    // modelProjectionMatrix is projection * worldMatrix
+    // Morph weights come from the snapshot too, only weights changed since the last frame are uploaded
+    void paintGL(const QMatrix4x4& projection, const QMatrix4x4& worldMatrix, const QMatrix4x4& modelProjectionMatrix, const QMatrix4x4* palette, const int paletteSize, const QVector<float>& morphWeights, FrameStatistics& statistics);
 
     QString getName() const;
+    // Sizes of the geometry built by the loader, they stay the same after upload
+    int getVertexCount() const;
+    int getIndexCount() const;
+    // Material of the loaded data if no other material is set
+    std::shared_ptr<Material> getMaterial() const;
     void setTransform(const Transform& transform);
     const Transform& getTransform() const;
+    QMatrix4x4 getWorldMatrix() const;
+
+    int getMorphTargetCount() const { return morphWeights.count(); }
+    QString getMorphTargetName(const int index) const;
+    int getMorphTargetIndex(const QString& name) const;
+    void setMorphWeight(const int index, const float weight);
+    float getMorphWeight(const int index) const { return morphWeights.value(index, 0); }
+    const QVector<float>& getMorphWeights() const { return morphWeights; }
+    // Sphere around the bind pose bounds transformed by the matrix, usually getWorldMatrix() with a view on the left
+    void getBoundingSphere(const QMatrix4x4& matrix, QVector3D& center, float& radius) const;
 
 private:
     void updateChildrenMatrix(const QMatrix4x4& parentMatrix);
+    // statistics is null outside of drawing
+    void uploadMorphWeights(const QVector<float>& weights, FrameStatistics* statistics);
 
     bool initializedGL = false;
+    bool resident = false;
+
+    QVector<float> morphWeights; // implicitly shared with snapshots
+    QVector<float> uploadedMorphWeights;
+    std::unique_ptr<QOpenGLTexture> morphWeightsTexture;
 
     QMatrix4x4 parentMatrix;
     Transform transform;
@@ -0,0 +1,745 @@
+#include "modelcache.h"
+#include "loader.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+#include <limits>
+
+namespace ofbxqt
+{
+
+struct ModelCacheHeader
+{
+    char magic[4];
+    quint32 version;
+    char contentHash[20]; // SHA-1 of the model file
+    char configHash[20];
+    qint64 sourceSize;
+    qint64 metadataOffset; // the metadata lasts to the end of the entry
+};
+
+static_assert(sizeof(ModelCacheHeader) == 64, "blobs must start at an aligned offset");
+
+static const char ModelCacheMagic[4] = { 'O', 'F', 'Q', 'M' };
+static const qint64 BlobAlignment = 16;
+static const QDataStream::Version StreamVersion = QDataStream::Qt_5_6;
+
+static qint64 alignOffset(const qint64 offset)
+{
+    return (offset + BlobAlignment - 1) / BlobAlignment * BlobAlignment;
+}
+
+int ModelCache::BlobWriter::add(const void* data, const qint64 size)
+{
+    if (size <= 0)
+    {
+        return -1;
+    }
+
+    Blob blob;
+    blob.data = reinterpret_cast<const char*>(data);
+    blob.size = size;
+    blob.offset = alignOffset(end);
+
+    end = blob.offset + blob.size;
+    blobs.append(blob);
+
+    return blobs.count() - 1;
+}
+
+ModelCache::BlobReader::BlobReader(const QByteArray& entry_, const bool mapped_, QDataStream& stream)
+    : entry(entry_)
+    , mapped(mapped_)
+{
+    stream >> offsets >> sizes;
+
+    if (stream.status() != QDataStream::Ok || offsets.count() != sizes.count())
+    {
+        return;
+    }
+
+    for (int i = 0; i < offsets.count(); ++i)
+    {
+        if (offsets[i] < qint64(sizeof(ModelCacheHeader)) || sizes[i] < 0 || offsets[i] + sizes[i] > entry.size())
+        {
+            return;
+        }
+    }
+
+    valid = true;
+}
+
+bool ModelCache::BlobReader::get(const int index, QByteArray& result) const
+{
+    if (index == -1)
+    {
+        result = QByteArray();
+        return true;
+    }
+
+    if (index < 0 || index >= offsets.count())
+    {
+        return false;
+    }
+
+    if (mapped)
+    {
+        result = QByteArray::fromRawData(entry.constData() + offsets[index], int(sizes[index]));
+    }
+    else
+    {
+        result = entry.mid(int(offsets[index]), int(sizes[index]));
+    }
+
+    return true;
+}
+
+template <typename T>
+bool ModelCache::BlobReader::get(const int index, QVector<T>& result) const
+{
+    QByteArray bytes;
+    if (!get(index, bytes) || bytes.size() % int(sizeof(T)) != 0)
+    {
+        return false;
+    }
+
+    result.resize(bytes.size() / int(sizeof(T)));
+    if (!bytes.isEmpty())
+    {
+        std::memcpy(result.data(), bytes.constData(), size_t(bytes.size()));
+    }
+
+    return true;
+}
+
+QString ModelCache::getEntryFileName(const QString& fileName, const QString& cacheDirectory)
+{
+    const QByteArray keyHash = QCryptographicHash::hash(QFileInfo(fileName).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDirectory + "/" + QString::fromLatin1(keyHash) + ".ofqmodel";
+}
+
+QByteArray ModelCache::getConfigHash(const OpenModelConfig& config)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(StreamVersion);
+
+    stream << config.loadTransform << config.loadArmature << config.loadMorphTargets << config.loadAnimation
+           << config.compressAnimation << config.animationTranslationTolerance << config.animationRotationTolerance << config.animationScaleTolerance
+           << config.loadMaterial << config.loadDiffuseTexture << config.loadDiffuseColor << config.loadNormalTexture;
+
+    return QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+}
+
+bool ModelCache::write(const QString& entryFileName, const QByteArray& contentHash, const QByteArray& configHash, const qint64 sourceSize,
+                       const FileInfo& fileInfo, const QList<Note>& notes, const QVector<TextureReference>& textures)
+{
+    if (!QDir().mkpath(QFileInfo(entryFileName).absolutePath()))
+    {
+        return false;
+    }
+
+    const QVector<std::shared_ptr<Model>>& models = fileInfo.allModels;
+
+    QHash<const Model*, int> modelIndices;
+    QHash<const Armature*, int> armatureIndices; // <armature, index of its model>
+    QHash<const Material*, int> materialIndices;
+    for (int i = 0; i < models.count(); ++i)
+    {
+        const std::shared_ptr<ModelData>& data = models[i]->data;
+        if (!data)
+        {
+            return false;
+        }
+
+        modelIndices.insert(models[i].get(), i);
+
+        if (data->armature)
+        {
+            armatureIndices.insert(data->armature.get(), i);
+        }
+
+        if (data->material)
+        {
+            materialIndices.insert(data->material.get(), i);
+        }
+    }
+
+    BlobWriter blobs(sizeof(ModelCacheHeader));
+
+    QByteArray body;
+    QDataStream stream(&body, QIODevice::WriteOnly);
+    stream.setVersion(StreamVersion);
+
+    stream << qint32(notes.count());
+    for (const Note& note : notes)
+    {
+        stream << qint32(note.getType()) << note.getText();
+    }
+
+    stream << qint32(models.count());
+    for (const std::shared_ptr<Model>& model : qAsConst(models))
+    {
+        const ModelData& data = *model->data;
+
+        stream << data.name << data.sourceMatrix << data.boundsMin << data.boundsMax;
+
+        stream << qint32(data.vertexAttributes.count());
+        for (const VertexAttributeInfo& attribute : qAsConst(data.vertexAttributes))
+        {
+            stream << attribute.nameForShader << qint32(attribute.offset) << qint32(attribute.tupleSize);
+        }
+
+        stream << qint32(data.vertexStride) << qint32(data.vertexCount) << qint32(blobs.add(data.vertexData.constData(), data.vertexData.size()));
+        stream << qint32(data.indexCount) << qint32(blobs.add(data.indexData.constData(), data.indexData.size()));
+
+        stream << qint32(data.morphTargets.count());
+        for (const MorphTarget& target : qAsConst(data.morphTargets))
+        {
+            stream << target.name << target.defaultWeight;
+        }
+
+        stream << qint32(data.morphEntryCount) << qint32(blobs.add(data.morphData.constData(), qint64(data.morphData.count()) * int(sizeof(float))));
+
+        stream << bool(data.material);
+        if (data.material)
+        {
+            stream << bool(data.material->diffuseColor);
+            if (data.material->diffuseColor)
+            {
+                stream << *data.material->diffuseColor;
+            }
+        }
+
+        // joints are in evaluation order, so a parent precedes its children
+        const std::shared_ptr<Armature>& armature = data.armature;
+        stream << bool(armature);
+        if (armature)
+        {
+            stream << qint32(armature->allJoints.count());
+            for (const std::shared_ptr<Joint>& joint : qAsConst(armature->allJoints))
+            {
+                stream << joint->name << joint->sourceMatrix << qint32(armature->parentIndices.value(int(joint->index), -1));
+            }
+
+            stream << qint32(armature->jointsByName.count());
+            for (auto it = armature->jointsByName.constBegin(); it != armature->jointsByName.constEnd(); ++it)
+            {
+                stream << it.key() << qint32(it.value());
+            }
+        }
+
+        stream << qint32(modelIndices.value(model->parent.lock().get(), -1));
+    }
+
+    stream << qint32(textures.count());
+    for (const TextureReference& texture : textures)
+    {
+        stream << qint32(materialIndices.value(texture.material.get(), -1)) << texture.typeStr << qint32(texture.meshIndex) << qint32(texture.materialIndex)
+               << texture.fileName << texture.name << texture.embeddedOffset << texture.embeddedSize;
+    }
+
+    stream << qint32(fileInfo.animationClips.count());
+    for (const std::shared_ptr<AnimationClip>& clip : qAsConst(fileInfo.animationClips))
+    {
+        stream << clip->name << clip->frameRate << qint32(clip->frameCount) << qint32(clip->layerIndex);
+
+        // a joint track is the model of the armature with the joint index, a model track has no joint index
+        stream << qint32(clip->tracks.count());
+        for (const AnimationTrack& track : qAsConst(clip->tracks))
+        {
+            const std::shared_ptr<Joint> joint = track.joint.lock();
+            if (joint)
+            {
+                stream << qint32(armatureIndices.value(joint->armature.lock().get(), -1)) << qint32(joint->index);
+            }
+            else
+            {
+                stream << qint32(modelIndices.value(track.model.lock().get(), -1)) << qint32(-1);
+            }
+        }
+
+        stream << qint32(clip->armatures.count());
+        for (const std::weak_ptr<Armature>& armature : qAsConst(clip->armatures))
+        {
+            stream << qint32(armatureIndices.value(armature.lock().get(), -1));
+        }
+
+        stream << clip->trackArmatures;
+
+        stream << clip->compressed << qint32(blobs.add(clip->keys.data(), qint64(clip->keys.size()) * int(sizeof(float))));
+
+        stream << qint32(clip->compressedTracks.count());
+        for (const AnimationClip::CompressedTrack& track : qAsConst(clip->compressedTracks))
+        {
+            stream << track.translationMin << track.translationExtent << track.scaleMin << track.scaleExtent
+                   << qint32(track.translation.firstKey) << qint32(track.translation.keyCount)
+                   << qint32(track.translation.firstValue) << track.translation.raw
+                   << qint32(track.rotation.firstKey) << qint32(track.rotation.keyCount)
+                   << qint32(track.rotation.firstValue) << track.rotation.raw
+                   << qint32(track.scale.firstKey) << qint32(track.scale.keyCount)
+                   << qint32(track.scale.firstValue) << track.scale.raw;
+        }
+
+        stream << qint32(blobs.add(clip->keyFrames.constData(), qint64(clip->keyFrames.count()) * int(sizeof(quint32))));
+        stream << qint32(blobs.add(clip->keyValues.constData(), qint64(clip->keyValues.count()) * int(sizeof(quint16))));
+        stream << qint32(blobs.add(clip->rawKeyValues.constData(), qint64(clip->rawKeyValues.count()) * int(sizeof(float))));
+    }
+
+    QVector<qint64> offsets;
+    QVector<qint64> sizes;
+    for (const Blob& blob : blobs.getBlobs())
+    {
+        offsets.append(blob.offset);
+        sizes.append(blob.size);
+    }
+
+    QByteArray metadata;
+    QDataStream tableStream(&metadata, QIODevice::WriteOnly);
+    tableStream.setVersion(StreamVersion);
+    tableStream << offsets << sizes;
+    metadata.append(body);
+
+    ModelCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, ModelCacheMagic, sizeof(header.magic));
+    header.version = Version;
+    std::memcpy(header.contentHash, contentHash.constData(), qMin(sizeof(header.contentHash), size_t(contentHash.size())));
+    std::memcpy(header.configHash, configHash.constData(), qMin(sizeof(header.configHash), size_t(configHash.size())));
+    header.sourceSize = sourceSize;
+    header.metadataOffset = alignOffset(blobs.getEnd());
+
+    // other processes see either the old entry or the complete new one
+    QSaveFile file(entryFileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    static const char Padding[BlobAlignment] = {};
+
+    qint64 position = 0;
+    bool result = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header));
+    position += sizeof(header);
+
+    for (const Blob& blob : blobs.getBlobs())
+    {
+        result = result && file.write(Padding, blob.offset - position) == blob.offset - position;
+        result = result && file.write(blob.data, blob.size) == blob.size;
+        position = blob.offset + blob.size;
+    }
+
+    result = result && file.write(Padding, header.metadataOffset - position) == header.metadataOffset - position;
+    result = result && file.write(metadata) == metadata.size();
+
+    if (!result)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+bool ModelCache::read(const QString& entryFileName, const QByteArray& contentHash, const QByteArray& configHash, const qint64 sourceSize,
+                      FileInfo& fileInfo, QVector<TextureReference>& textures)
+{
+    std::shared_ptr<QFile> file = std::make_shared<QFile>(entryFileName);
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    ModelCacheHeader header;
+    if (file->read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header)))
+    {
+        return false;
+    }
+
+    if (std::memcmp(header.magic, ModelCacheMagic, sizeof(header.magic)) != 0 || header.version != Version
+            || header.sourceSize != sourceSize
+            || contentHash.size() != int(sizeof(header.contentHash))
+            || std::memcmp(header.contentHash, contentHash.constData(), sizeof(header.contentHash)) != 0
+            || configHash.size() != int(sizeof(header.configHash))
+            || std::memcmp(header.configHash, configHash.constData(), sizeof(header.configHash)) != 0)
+    {
+        return false;
+    }
+
+    const qint64 size = file->size();
+    if (header.metadataOffset < qint64(sizeof(header)) || header.metadataOffset > size || size > std::numeric_limits<int>::max())
+    {
+        qWarning() << Q_FUNC_INFO << "invalid cache entry" << entryFileName;
+        return false;
+    }
+
+    // vertex and index data reference the mapping, the models keep the file
+    QByteArray entry;
+    const uchar* mapped = file->map(0, size);
+    if (mapped)
+    {
+        entry = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), int(size));
+    }
+    else
+    {
+        file->seek(0);
+        entry = file->readAll();
+        if (entry.size() != size)
+        {
+            return false;
+        }
+    }
+
+    const QByteArray metadata = QByteArray::fromRawData(entry.constData() + header.metadataOffset, int(size - header.metadataOffset));
+    QDataStream stream(metadata);
+    stream.setVersion(StreamVersion);
+
+    const BlobReader blobs(entry, mapped != nullptr, stream);
+    if (!blobs.isValid())
+    {
+        qWarning() << Q_FUNC_INFO << "invalid blobs in cache entry" << entryFileName;
+        return false;
+    }
+
+    FileInfo result;
+    result.absoluteFileName = fileInfo.absoluteFileName;
+    result.fileName = fileInfo.fileName;
+    result.statistics = fileInfo.statistics;
+
+    bool valid = true;
+    qint32 count = 0;
+
+    stream >> count;
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        qint32 type = 0;
+        QString text;
+        stream >> type >> text;
+        result.notes.append(Note(Note::Type(type), text));
+    }
+
+    stream >> count;
+    QVector<int> parentIndices;
+    for (int i = 0; i < count && valid && stream.status() == QDataStream::Ok; ++i)
+    {
+        std::shared_ptr<ModelData> data(new ModelData());
+        if (mapped)
+        {
+            data->mappedFile = file;
+        }
+
+        stream >> data->name >> data->sourceMatrix >> data->boundsMin >> data->boundsMax;
+
+        qint32 attributeCount = 0;
+        stream >> attributeCount;
+        for (int j = 0; j < attributeCount && stream.status() == QDataStream::Ok; ++j)
+        {
+            VertexAttributeInfo attribute;
+            qint32 offset = 0;
+            qint32 tupleSize = 0;
+            stream >> attribute.nameForShader >> offset >> tupleSize;
+            attribute.offset = offset;
+            attribute.tupleSize = tupleSize;
+            data->vertexAttributes.append(attribute);
+        }
+
+        qint32 vertexStride = 0;
+        qint32 vertexCount = 0;
+        qint32 vertexBlob = -1;
+        qint32 indexCount = 0;
+        qint32 indexBlob = -1;
+        stream >> vertexStride >> vertexCount >> vertexBlob >> indexCount >> indexBlob;
+        data->vertexStride = vertexStride;
+        data->vertexCount = vertexCount;
+        data->indexCount = indexCount;
+        valid = blobs.get(vertexBlob, data->vertexData) && data->vertexData.size() == qint64(vertexCount) * vertexStride
+                && blobs.get(indexBlob, data->indexData) && data->indexData.size() == qint64(indexCount) * data->indexStride;
+
+        qint32 morphTargetCount = 0;
+        stream >> morphTargetCount;
+        for (int j = 0; j < morphTargetCount && stream.status() == QDataStream::Ok; ++j)
+        {
+            MorphTarget target;
+            stream >> target.name >> target.defaultWeight;
+            data->morphTargets.append(target);
+        }
+
+        qint32 morphEntryCount = 0;
+        qint32 morphBlob = -1;
+        stream >> morphEntryCount >> morphBlob;
+        data->morphEntryCount = morphEntryCount;
+        valid = valid && blobs.get(morphBlob, data->morphData);
+
+        bool hasMaterial = false;
+        stream >> hasMaterial;
+        if (hasMaterial)
+        {
+            data->material = std::shared_ptr<Material>(new Material());
+
+            bool hasDiffuseColor = false;
+            stream >> hasDiffuseColor;
+            if (hasDiffuseColor)
+            {
+                QColor color;
+                stream >> color;
+                data->material->diffuseColor = std::unique_ptr<QColor>(new QColor(color));
+            }
+        }
+
+        bool hasArmature = false;
+        stream >> hasArmature;
+        if (hasArmature)
+        {
+            data->armature = std::shared_ptr<Armature>(new Armature());
+            Armature& armature = *data->armature;
+
+            qint32 jointCount = 0;
+            stream >> jointCount;
+            for (int j = 0; j < jointCount && valid && stream.status() == QDataStream::Ok; ++j)
+            {
+                QString name;
+                QMatrix4x4 sourceMatrix;
+                qint32 parentIndex = -1;
+                stream >> name >> sourceMatrix >> parentIndex;
+
+                std::shared_ptr<Joint> joint = std::shared_ptr<Joint>(new Joint(name, GLuint(j), sourceMatrix));
+                joint->armature = data->armature;
+
+                if (parentIndex >= 0 && parentIndex < j)
+                {
+                    const std::shared_ptr<Joint>& parent = armature.allJoints[parentIndex];
+                    parent->children.append(joint);
+                    joint->parent = parent;
+                }
+                else if (parentIndex == -1)
+                {
+                    armature.topLevelJoints.append(joint);
+                }
+                else
+                {
+                    valid = false;
+                }
+
+                armature.allJoints.append(joint);
+            }
+
+            qint32 nameCount = 0;
+            stream >> nameCount;
+            for (int j = 0; j < nameCount && stream.status() == QDataStream::Ok; ++j)
+            {
+                QString name;
+                qint32 index = 0;
+                stream >> name >> index;
+                armature.jointsByName.insert(name, index);
+            }
+
+            // the order is kept, so joint indices in the vertex data stay valid
+            armature.buildEvaluationOrder();
+        }
+
+        qint32 parentIndex = -1;
+        stream >> parentIndex;
+        parentIndices.append(parentIndex);
+
+        std::shared_ptr<Model> model(new Model(data));
+        if (data->armature)
+        {
+            data->armature->model = model;
+            data->armature->update();
+            model->armature = data->armature;
+        }
+
+        result.allModels.append(model);
+    }
+
+    for (int i = 0; i < parentIndices.count() && valid; ++i)
+    {
+        const int parentIndex = parentIndices[i];
+        if (parentIndex == -1)
+        {
+            result.topLevelModels.append(result.allModels[i]);
+        }
+        else if (parentIndex >= 0 && parentIndex < result.allModels.count() && parentIndex != i)
+        {
+            result.allModels[i]->parent = result.allModels[parentIndex];
+            result.allModels[parentIndex]->children.append(result.allModels[i]);
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    QVector<TextureReference> resultTextures;
+    stream >> count;
+    for (int i = 0; i < count && valid && stream.status() == QDataStream::Ok; ++i)
+    {
+        TextureReference texture;
+        qint32 modelIndex = -1;
+        qint32 meshIndex = -1;
+        qint32 materialIndex = -1;
+        stream >> modelIndex >> texture.typeStr >> meshIndex >> materialIndex
+               >> texture.fileName >> texture.name >> texture.embeddedOffset >> texture.embeddedSize;
+        texture.meshIndex = meshIndex;
+        texture.materialIndex = materialIndex;
+
+        if (modelIndex < 0 || modelIndex >= result.allModels.count() || !result.allModels[modelIndex]->data->material)
+        {
+            valid = false;
+            break;
+        }
+
+        texture.material = result.allModels[modelIndex]->data->material;
+        resultTextures.append(texture);
+    }
+
+    stream >> count;
+    for (int i = 0; i < count && valid && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString name;
+        double frameRate = 0;
+        qint32 frameCount = 0;
+        qint32 layerIndex = 0;
+        stream >> name >> frameRate >> frameCount >> layerIndex;
+
+        qint32 trackCount = 0;
+        stream >> trackCount;
+        QVector<AnimationTrack> tracks;
+        for (int j = 0; j < trackCount && valid && stream.status() == QDataStream::Ok; ++j)
+        {
+            qint32 modelIndex = -1;
+            qint32 jointIndex = -1;
+            stream >> modelIndex >> jointIndex;
+
+            if (modelIndex < 0 || modelIndex >= result.allModels.count())
+            {
+                valid = false;
+                break;
+            }
+
+            AnimationTrack track;
+            const std::shared_ptr<Model>& model = result.allModels[modelIndex];
+            if (jointIndex == -1)
+            {
+                track.model = model;
+            }
+            else if (model->data->armature && jointIndex >= 0 && jointIndex < model->data->armature->allJoints.count())
+            {
+                track.joint = model->data->armature->allJoints[jointIndex];
+            }
+            else
+            {
+                valid = false;
+                break;
+            }
+
+            tracks.append(track);
+        }
+
+        if (!valid || frameCount < 0)
+        {
+            valid = false;
+            break;
+        }
+
+        std::shared_ptr<AnimationClip> clip = std::shared_ptr<AnimationClip>(new AnimationClip(name, frameRate, frameCount, tracks));
+        clip->layerIndex = layerIndex;
+
+        qint32 armatureCount = 0;
+        stream >> armatureCount;
+        for (int j = 0; j < armatureCount && stream.status() == QDataStream::Ok; ++j)
+        {
+            qint32 modelIndex = -1;
+            stream >> modelIndex;
+
+            if (modelIndex < 0 || modelIndex >= result.allModels.count() || !result.allModels[modelIndex]->data->armature)
+            {
+                valid = false;
+                break;
+            }
+
+            clip->armatures.append(result.allModels[modelIndex]->data->armature);
+        }
+
+        qint32 keysBlob = -1;
+        stream >> clip->trackArmatures >> clip->compressed >> keysBlob;
+
+        QByteArray keys;
+        valid = valid && blobs.get(keysBlob, keys);
+        if (clip->compressed)
+        {
+            clip->keys.resize(0);
+        }
+        else if (keys.size() == qint64(clip->keys.size()) * int(sizeof(float)))
+        {
+            if (!keys.isEmpty())
+            {
+                std::memcpy(clip->keys.data(), keys.constData(), size_t(keys.size()));
+            }
+        }
+        else
+        {
+            valid = false;
+        }
+
+        qint32 compressedTrackCount = 0;
+        stream >> compressedTrackCount;
+        for (int j = 0; j < compressedTrackCount && stream.status() == QDataStream::Ok; ++j)
+        {
+            AnimationClip::CompressedTrack track;
+            stream >> track.translationMin >> track.translationExtent >> track.scaleMin >> track.scaleExtent;
+
+            AnimationClip::CompressedChannel* channels[3] = { &track.translation, &track.rotation, &track.scale };
+            for (AnimationClip::CompressedChannel* channel : channels)
+            {
+                qint32 values[3] = {};
+                stream >> values[0] >> values[1] >> values[2] >> channel->raw;
+                channel->firstKey = values[0];
+                channel->keyCount = values[1];
+                channel->firstValue = values[2];
+            }
+
+            clip->compressedTracks.append(track);
+        }
+
+        qint32 keyFramesBlob = -1;
+        qint32 keyValuesBlob = -1;
+        qint32 rawKeyValuesBlob = -1;
+        stream >> keyFramesBlob >> keyValuesBlob >> rawKeyValuesBlob;
+        valid = valid && blobs.get(keyFramesBlob, clip->keyFrames) && blobs.get(keyValuesBlob, clip->keyValues)
+                && blobs.get(rawKeyValuesBlob, clip->rawKeyValues);
+
+        result.animationClips.append(clip);
+    }
+
+    if (!valid || stream.status() != QDataStream::Ok)
+    {
+        qWarning() << Q_FUNC_INFO << "invalid cache entry" << entryFileName;
+        return false;
+    }
+
+    fileInfo = result;
+    textures = resultTextures;
+
+    return true;
+}
+
+bool ModelCache::clear(const QString& cacheDirectory)
+{
+    QDir dir(cacheDirectory);
+
+    bool result = true;
+    for (const QString& entry : dir.entryList(QStringList("*.ofqmodel"), QDir::Files))
+    {
+        result = dir.remove(entry) && result;
+    }
+
+    return result;
+}
+
+}
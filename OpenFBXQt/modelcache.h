@@ -0,0 +1,100 @@
+#pragma once
+
+#include "openfbxqt.h"
+#include <QByteArray>
+#include <QVector>
+#include <memory>
+
+class QDataStream;
+
+namespace ofbxqt
+{
+
+struct FileInfo;
+class Material;
+
+// Directory of post-processed models. An entry belongs to the absolute path of the model file and holds what the
+// loader built from it: interleaved vertex and index data, vertex layouts, materials, armatures, animation clips and
+// notes. It is used while the SHA-1 of the file and the loading options match. Vertex and index data are mapped
+// from the entry and uploaded from the mapping, textures are referenced and decoded again by the loader
+class ModelCache
+{
+public:
+    // Texture of a material, either a file or an image embedded in the model file
+    struct TextureReference
+    {
+        std::shared_ptr<Material> material;
+        QString typeStr;
+        int meshIndex = -1;
+        int materialIndex = -1;
+
+        QString fileName; // absolute
+        QString name; // of an embedded image
+        qint64 embeddedOffset = -1; // of the embedded data in the model file
+        qint64 embeddedSize = 0;
+
+        bool isEmbedded() const { return embeddedOffset >= 0; }
+        bool isEmpty() const { return fileName.isEmpty() && !isEmbedded(); }
+    };
+
+    static QString getEntryFileName(const QString& fileName, const QString& cacheDirectory);
+    // Hash of the options which change the result of loading
+    static QByteArray getConfigHash(const OpenModelConfig& config);
+
+    // Returns false if the entry is missing, outdated or damaged. Texture references are resolved by the caller
+    static bool read(const QString& entryFileName, const QByteArray& contentHash, const QByteArray& configHash, const qint64 sourceSize,
+                     FileInfo& fileInfo, QVector<TextureReference>& textures);
+    static bool write(const QString& entryFileName, const QByteArray& contentHash, const QByteArray& configHash, const qint64 sourceSize,
+                      const FileInfo& fileInfo, const QList<Note>& notes, const QVector<TextureReference>& textures);
+
+    // Removes all entries of the directory
+    static bool clear(const QString& cacheDirectory);
+
+private:
+    static const quint32 Version = 2;
+
+    struct Blob
+    {
+        const char* data = nullptr;
+        qint64 size = 0;
+        qint64 offset = 0;
+    };
+
+    // Large arrays are stored outside of the metadata at 16-byte aligned offsets
+    class BlobWriter
+    {
+    public:
+        explicit BlobWriter(const qint64 begin) : end(begin) {}
+
+        // Returns the index of the blob, the data must live until the entry is written
+        int add(const void* data, const qint64 size);
+        qint64 getEnd() const { return end; }
+        const QVector<Blob>& getBlobs() const { return blobs; }
+
+    private:
+        QVector<Blob> blobs;
+        qint64 end = 0;
+    };
+
+    class BlobReader
+    {
+    public:
+        // Reads the table of blobs from the beginning of the metadata
+        BlobReader(const QByteArray& entry, const bool mapped, QDataStream& stream);
+
+        bool isValid() const { return valid; }
+        // Arrays of a mapped entry reference the mapping. An index of -1 gives an empty array
+        bool get(const int index, QByteArray& result) const;
+        template <typename T>
+        bool get(const int index, QVector<T>& result) const;
+
+    private:
+        const QByteArray& entry;
+        const bool mapped;
+        QVector<qint64> offsets;
+        QVector<qint64> sizes;
+        bool valid = false;
+    };
+};
+
+}
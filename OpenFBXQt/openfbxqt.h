@@ -1,5 +1,6 @@
 #pragma once
 
+#include "simdmatrix.h"
 #include <QString>
 #include <QQuaternion>
 #include <QMatrix4x4>
@@ -13,6 +14,15 @@ struct OpenModelConfig
 {
     bool loadTransform = true;
     bool loadArmature = true;
+    bool loadMorphTargets = true;
+    bool loadAnimation = true;
+
+    // Keyframe reduction and quantization of animation tracks. Tolerances bound the error of a sampled channel,
+    // a channel that can not be quantized within them keeps reduced keys at full precision
+    bool compressAnimation = true;
+    float animationTranslationTolerance = 0.01f; // in model units
+    float animationRotationTolerance = 0.5f; // in degrees
+    float animationScaleTolerance = 0.001f;
 
     bool loadMaterial = true;
 
@@ -20,6 +30,14 @@ struct OpenModelConfig
     bool loadDiffuseColor = true;
 
     bool loadNormalTexture = true;
+
+    // Directory for decoded textures with mip levels, so images are not decoded again on the next open.
+    // Empty disables the cache
+    QString textureCacheDirectory;
+
+    // Directory for post-processed models, an unchanged file opened with the same options skips parsing.
+    // Empty disables the cache
+    QString modelCacheDirectory;
 };
 
 class Note
@@ -60,15 +78,9 @@ public:
     {
     }
 
+    // The matrix is kept up to date by setters, so a const Transform can be read from any thread
     const QMatrix4x4& getResultMatrix() const
     {
-        if (needUpdateResultMatrix)
-        {
-            Transform* this_ = const_cast<Transform*>(this);
-            this_->updateResultMatrix();
-            this_->needUpdateResultMatrix = false;
-        }
-
         return resultMatrix;
     }
 
@@ -80,7 +92,7 @@ public:
     void setScale(const QVector3D& scale_)
     {
         scale = scale_;
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
     }
 
     const QVector3D& getTanslation() const
@@ -91,7 +103,7 @@ public:
     void setTranslation(const QVector3D& translation_)
     {
         translation = translation_;
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
     }
 
     const QQuaternion& getRotation() const
@@ -103,14 +115,24 @@ public:
     {
         rotation = rotation_;
         eulerAngles = rotation.toEulerAngles();
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
+    }
+
+    // Sets the three parts and builds the matrix once, for transforms changed every frame
+    void setTRS(const QVector3D& translation_, const QQuaternion& rotation_, const QVector3D& scale_)
+    {
+        translation = translation_;
+        rotation = rotation_;
+        eulerAngles = rotation.toEulerAngles();
+        scale = scale_;
+        updateResultMatrix();
     }
 
     void setEulerAngles(const QVector3D& eulerAngles_)
     {
         eulerAngles = eulerAngles_;
         rotation = QQuaternion::fromEulerAngles(eulerAngles);
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
     }
 
     const QVector3D& getEulerAngles() const
@@ -126,7 +148,7 @@ public:
     void setRotationPivot(const QVector3D& rotationPivot_)
     {
         rotationPivot = rotationPivot_;
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
     }
 
     const QVector3D& getScalePivot() const
@@ -137,7 +159,7 @@ public:
     void setScalePivot(const QVector3D& scalePivot_)
     {
         scalePivot = scalePivot_;
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
     }
 
     const QMatrix4x4& getAdditionalMatrix() const
@@ -148,7 +170,7 @@ public:
     void setAdditionalMatrix(const QMatrix4x4& additionalMatrix_)
     {
         additionalMatrix = additionalMatrix_;
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
     }
 
     TransformOrder getTransformOrder() const
@@ -159,7 +181,7 @@ public:
     void setTransformOrder(const TransformOrder transformOrder_)
     {
         transformOrder = transformOrder_;
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
     }
 
     RotationOrder getRotationOrder() const
@@ -170,28 +192,24 @@ public:
     void setRotationOrder(const RotationOrder rotationOrder_)
     {
         rotationOrder = rotationOrder_;
-        needUpdateResultMatrix = true;
+        updateResultMatrix();
     }
 
     void updateResultMatrix()
     {
-        resultMatrix = additionalMatrix;
-
-        resultMatrix.translate(translation);
+        // translation * rotationPivot * rotation * rotationPivot^-1 * scalePivot * scale * scalePivot^-1
+        // composed directly, pivots only move the translation of rotation * scale
+        const QVector3D pivotOffset = rotation.rotatedVector(scalePivot - rotationPivot - scale * scalePivot);
+        resultMatrix = simd::composeTRS(translation + rotationPivot + pivotOffset, rotation, scale);
 
-        resultMatrix.translate(rotationPivot);
-        resultMatrix.rotate(rotation);
-        resultMatrix.translate(-rotationPivot);
-
-        resultMatrix.translate(scalePivot);
-        resultMatrix.scale(scale);
-        resultMatrix.translate(-scalePivot);
+        if (!additionalMatrix.isIdentity())
+        {
+            resultMatrix = simd::multiply(additionalMatrix, resultMatrix);
+        }
     }
 
 private:
 
-    bool needUpdateResultMatrix = false;
-
     QMatrix4x4 resultMatrix;
 
     QVector3D translation;
@@ -0,0 +1,366 @@
+#include "pose.h"
+#include "simd.h"
+
+namespace ofbxqt
+{
+
+PoseMask::PoseMask(std::shared_ptr<Armature> armature_, const float weight)
+    : armature(armature_)
+{
+    if (!armature_)
+    {
+        qCritical() << Q_FUNC_INFO << "armature is null";
+        return;
+    }
+
+    jointCount = armature_->getAllJoints().count();
+    weights.resize((jointCount + simd::Width - 1) / simd::Width * simd::Width);
+    std::fill(weights.data(), weights.data() + jointCount, weight);
+}
+
+void PoseMask::setWeight(const int jointIndex, const float weight)
+{
+    if (jointIndex < 0 || jointIndex >= jointCount)
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    weights[jointIndex] = weight;
+}
+
+float PoseMask::getWeight(const int jointIndex) const
+{
+    if (jointIndex < 0 || jointIndex >= jointCount)
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return 0;
+    }
+
+    return weights[jointIndex];
+}
+
+void PoseMask::setSubtreeWeight(const std::shared_ptr<Joint>& joint, const float weight)
+{
+    const std::shared_ptr<Armature> armature_ = armature.lock();
+    if (!joint || !armature_ || joint->armature.lock() != armature_)
+    {
+        qCritical() << Q_FUNC_INFO << "joint does not belong to armature of mask";
+        return;
+    }
+
+    const int begin = joint->index;
+    const int end = qMin(armature_->subtreeEnds.value(begin, begin), jointCount);
+    std::fill(weights.data() + begin, weights.data() + end, weight);
+}
+
+Pose::Pose(std::shared_ptr<Armature> armature_)
+    : armature(armature_)
+{
+    if (!armature_)
+    {
+        qCritical() << Q_FUNC_INFO << "armature is null";
+        return;
+    }
+
+    jointCount = armature_->getAllJoints().count();
+    stride = (jointCount + simd::Width - 1) / simd::Width * simd::Width;
+    values.resize(AnimationClip::ChannelCount * stride);
+
+    readFromArmature();
+}
+
+Transform Pose::getTransform(const int jointIndex) const
+{
+    if (jointIndex < 0 || jointIndex >= jointCount)
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return Transform();
+    }
+
+    return AnimationClip::getTransform(values.data(), stride, jointIndex);
+}
+
+void Pose::setTransform(const int jointIndex, const Transform& transform)
+{
+    if (jointIndex < 0 || jointIndex >= jointCount)
+    {
+        qCritical() << Q_FUNC_INFO << "index out of bound";
+        return;
+    }
+
+    const QVector3D& translation = transform.getTanslation();
+    const QQuaternion& rotation = transform.getRotation();
+    const QVector3D& scale = transform.getScale();
+
+    float* value = values.data() + jointIndex;
+
+    value[AnimationClip::TranslationX * stride] = translation.x();
+    value[AnimationClip::TranslationY * stride] = translation.y();
+    value[AnimationClip::TranslationZ * stride] = translation.z();
+
+    value[AnimationClip::RotationX * stride] = rotation.x();
+    value[AnimationClip::RotationY * stride] = rotation.y();
+    value[AnimationClip::RotationZ * stride] = rotation.z();
+    value[AnimationClip::RotationW * stride] = rotation.scalar();
+
+    value[AnimationClip::ScaleX * stride] = scale.x();
+    value[AnimationClip::ScaleY * stride] = scale.y();
+    value[AnimationClip::ScaleZ * stride] = scale.z();
+}
+
+void Pose::readFromArmature()
+{
+    const std::shared_ptr<Armature> armature_ = armature.lock();
+    if (!armature_)
+    {
+        qCritical() << Q_FUNC_INFO << "armature is null";
+        return;
+    }
+
+    const QVector<std::shared_ptr<Joint>>& joints = armature_->getAllJoints();
+    for (int i = 0; i < qMin(joints.count(), jointCount); ++i)
+    {
+        setTransform(i, joints[i]->getTransform());
+    }
+}
+
+void Pose::sample(const std::shared_ptr<AnimationClip>& clip, const double time)
+{
+    if (!clip)
+    {
+        qCritical() << Q_FUNC_INFO << "clip is null";
+        return;
+    }
+
+    if (!binding || binding->getClip() != clip)
+    {
+        binding = std::make_shared<AnimationBinding>(clip, armature.lock());
+    }
+
+    sample(*binding, time);
+}
+
+void Pose::sample(const AnimationBinding& binding_, const double time)
+{
+    const std::shared_ptr<AnimationClip> clip = binding_.getClip();
+    if (!clip)
+    {
+        qCritical() << Q_FUNC_INFO << "clip is null";
+        return;
+    }
+
+    if (binding_.getJointCount() != jointCount)
+    {
+        qCritical() << Q_FUNC_INFO << "binding is not compatible with the pose";
+        return;
+    }
+
+    if (clipPose.size() != clip->getPoseSize())
+    {
+        clipPose.resize(clip->getPoseSize());
+    }
+
+    clip->sample(time, clipPose.data());
+
+    const QVector<int>& jointTracks = binding_.getJointTracks();
+    const int clipStride = clip->getTrackStride();
+    for (int i = 0; i < jointCount; ++i)
+    {
+        const int track = jointTracks[i];
+        if (track == -1)
+        {
+            continue;
+        }
+
+        for (int channel = 0; channel < AnimationClip::ChannelCount; ++channel)
+        {
+            values[channel * stride + i] = clipPose[channel * clipStride + track];
+        }
+    }
+}
+
+void Pose::blend(const Pose& target, const float weight, const PoseMask* mask)
+{
+    using namespace simd;
+
+    if (!isCompatible(target) || !isCompatible(mask))
+    {
+        return;
+    }
+
+    const float4 weight4 = set1(weight);
+
+    float* tx = getChannel(AnimationClip::TranslationX);
+    float* rx = getChannel(AnimationClip::RotationX);
+    float* ry = getChannel(AnimationClip::RotationY);
+    float* rz = getChannel(AnimationClip::RotationZ);
+    float* rw = getChannel(AnimationClip::RotationW);
+    float* sx = getChannel(AnimationClip::ScaleX);
+
+    const float* targetTx = target.getChannel(AnimationClip::TranslationX);
+    const float* targetRx = target.getChannel(AnimationClip::RotationX);
+    const float* targetRy = target.getChannel(AnimationClip::RotationY);
+    const float* targetRz = target.getChannel(AnimationClip::RotationZ);
+    const float* targetRw = target.getChannel(AnimationClip::RotationW);
+    const float* targetSx = target.getChannel(AnimationClip::ScaleX);
+
+    for (int i = 0; i < stride; i += Width)
+    {
+        const float4 t = mask ? mul(weight4, load(mask->getWeights() + i)) : weight4;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const int offset = axis * stride + i;
+            store(tx + offset, lerp(load(tx + offset), load(targetTx + offset), t));
+            store(sx + offset, lerp(load(sx + offset), load(targetSx + offset), t));
+        }
+
+        // nlerp along the shortest arc
+        const float4 x = load(rx + i);
+        const float4 y = load(ry + i);
+        const float4 z = load(rz + i);
+        const float4 w = load(rw + i);
+
+        float4 targetX = load(targetRx + i);
+        float4 targetY = load(targetRy + i);
+        float4 targetZ = load(targetRz + i);
+        float4 targetW = load(targetRw + i);
+
+        const float4 dot = add(add(mul(x, targetX), mul(y, targetY)), add(mul(z, targetZ), mul(w, targetW)));
+        targetX = mulSign(targetX, dot);
+        targetY = mulSign(targetY, dot);
+        targetZ = mulSign(targetZ, dot);
+        targetW = mulSign(targetW, dot);
+
+        store(rx + i, lerp(x, targetX, t));
+        store(ry + i, lerp(y, targetY, t));
+        store(rz + i, lerp(z, targetZ, t));
+        store(rw + i, lerp(w, targetW, t));
+    }
+
+    normalizeQuaternions(rx, ry, rz, rw, stride);
+}
+
+void Pose::addAdditive(const Pose& additive, const Pose& reference, const float weight, const PoseMask* mask)
+{
+    using namespace simd;
+
+    if (!isCompatible(additive) || !isCompatible(reference) || !isCompatible(mask))
+    {
+        return;
+    }
+
+    const float4 weight4 = set1(weight);
+    const float4 one = set1(1.0f);
+    const float4 epsilon = set1(1e-12f);
+
+    float* tx = getChannel(AnimationClip::TranslationX);
+    float* rx = getChannel(AnimationClip::RotationX);
+    float* ry = getChannel(AnimationClip::RotationY);
+    float* rz = getChannel(AnimationClip::RotationZ);
+    float* rw = getChannel(AnimationClip::RotationW);
+    float* sx = getChannel(AnimationClip::ScaleX);
+
+    const float* additiveTx = additive.getChannel(AnimationClip::TranslationX);
+    const float* additiveRx = additive.getChannel(AnimationClip::RotationX);
+    const float* additiveRy = additive.getChannel(AnimationClip::RotationY);
+    const float* additiveRz = additive.getChannel(AnimationClip::RotationZ);
+    const float* additiveRw = additive.getChannel(AnimationClip::RotationW);
+    const float* additiveSx = additive.getChannel(AnimationClip::ScaleX);
+
+    const float* referenceTx = reference.getChannel(AnimationClip::TranslationX);
+    const float* referenceRx = reference.getChannel(AnimationClip::RotationX);
+    const float* referenceRy = reference.getChannel(AnimationClip::RotationY);
+    const float* referenceRz = reference.getChannel(AnimationClip::RotationZ);
+    const float* referenceRw = reference.getChannel(AnimationClip::RotationW);
+    const float* referenceSx = reference.getChannel(AnimationClip::ScaleX);
+
+    for (int i = 0; i < stride; i += Width)
+    {
+        const float4 t = mask ? mul(weight4, load(mask->getWeights() + i)) : weight4;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const int offset = axis * stride + i;
+
+            const float4 translationDelta = sub(load(additiveTx + offset), load(referenceTx + offset));
+            store(tx + offset, add(load(tx + offset), mul(translationDelta, t)));
+
+            // scale is multiplicative
+            const float4 scaleRatio = div(load(additiveSx + offset), add(load(referenceSx + offset), epsilon));
+            store(sx + offset, mul(load(sx + offset), lerp(one, scaleRatio, t)));
+        }
+
+        // delta = additive * conjugate(reference)
+        const float4 ax = load(additiveRx + i);
+        const float4 ay = load(additiveRy + i);
+        const float4 az = load(additiveRz + i);
+        const float4 aw = load(additiveRw + i);
+
+        const float4 bx = load(referenceRx + i);
+        const float4 by = load(referenceRy + i);
+        const float4 bz = load(referenceRz + i);
+        const float4 bw = load(referenceRw + i);
+
+        float4 dw = add(add(mul(aw, bw), mul(ax, bx)), add(mul(ay, by), mul(az, bz)));
+        float4 dx = sub(add(mul(ax, bw), mul(az, by)), add(mul(aw, bx), mul(ay, bz)));
+        float4 dy = sub(add(mul(ay, bw), mul(ax, bz)), add(mul(aw, by), mul(az, bx)));
+        float4 dz = sub(add(mul(az, bw), mul(ay, bx)), add(mul(aw, bz), mul(ax, by)));
+
+        // weighted delta, nlerp from identity along the shortest arc
+        dx = mul(mulSign(dx, dw), t);
+        dy = mul(mulSign(dy, dw), t);
+        dz = mul(mulSign(dz, dw), t);
+        dw = lerp(one, mulSign(dw, dw), t);
+
+        // result = delta * current, normalized by the caller below
+        const float4 x = load(rx + i);
+        const float4 y = load(ry + i);
+        const float4 z = load(rz + i);
+        const float4 w = load(rw + i);
+
+        store(rw + i, sub(mul(dw, w), add(add(mul(dx, x), mul(dy, y)), mul(dz, z))));
+        store(rx + i, add(add(mul(dw, x), mul(dx, w)), sub(mul(dy, z), mul(dz, y))));
+        store(ry + i, add(add(mul(dw, y), mul(dy, w)), sub(mul(dz, x), mul(dx, z))));
+        store(rz + i, add(add(mul(dw, z), mul(dz, w)), sub(mul(dx, y), mul(dy, x))));
+    }
+
+    normalizeQuaternions(rx, ry, rz, rw, stride);
+}
+
+void Pose::apply() const
+{
+    const std::shared_ptr<Armature> armature_ = armature.lock();
+    if (!armature_)
+    {
+        qCritical() << Q_FUNC_INFO << "armature is null";
+        return;
+    }
+
+    armature_->setPose(*this);
+}
+
+bool Pose::isCompatible(const Pose& other) const
+{
+    if (other.armature.lock() != armature.lock() || other.stride != stride)
+    {
+        qCritical() << Q_FUNC_INFO << "poses belong to different armatures";
+        return false;
+    }
+
+    return true;
+}
+
+bool Pose::isCompatible(const PoseMask* mask) const
+{
+    if (mask && mask->getJointCount() != jointCount)
+    {
+        qCritical() << Q_FUNC_INFO << "mask does not match pose";
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "animationbinding.h"
+
+namespace ofbxqt
+{
+
+// Per-joint weights of a pose operation
+class PoseMask
+{
+public:
+    explicit PoseMask(std::shared_ptr<Armature> armature, const float weight = 0);
+
+    int getJointCount() const { return jointCount; }
+
+    void setWeight(const int jointIndex, const float weight);
+    float getWeight(const int jointIndex) const;
+
+    // Sets the weight of the joint and all its descendants
+    void setSubtreeWeight(const std::shared_ptr<Joint>& joint, const float weight);
+
+    const float* getWeights() const { return weights.data(); }
+
+private:
+    std::weak_ptr<Armature> armature;
+    int jointCount = 0;
+    AlignedBuffer<float> weights;
+};
+
+// Local transforms of all joints of an armature, stored in the channel layout of AnimationClip
+// with Armature::getAllJoints() order. Operations touch only the flat arrays, Joint transforms are
+// not involved until the pose is applied
+class Pose
+{
+public:
+    explicit Pose(std::shared_ptr<Armature> armature);
+
+    std::shared_ptr<Armature> getArmature() const { return armature.lock(); }
+    int getJointCount() const { return jointCount; }
+    int getStride() const { return stride; }
+
+    float* getChannel(const AnimationClip::Channel channel) { return values.data() + channel * stride; }
+    const float* getChannel(const AnimationClip::Channel channel) const { return values.data() + channel * stride; }
+
+    Transform getTransform(const int jointIndex) const;
+    void setTransform(const int jointIndex, const Transform& transform);
+
+    // Copies the current transforms of the joints
+    void readFromArmature();
+
+    // Joints without a track in the clip keep their values
+    void sample(const std::shared_ptr<AnimationClip>& clip, const double time);
+    // Same with a binding shared between armatures of the same hierarchy
+    void sample(const AnimationBinding& binding, const double time);
+
+    // Moves towards the target pose by the weight, multiplied by the mask if it is set
+    void blend(const Pose& target, const float weight, const PoseMask* mask = nullptr);
+
+    // Adds the difference between the additive and the reference poses
+    void addAdditive(const Pose& additive, const Pose& reference, const float weight, const PoseMask* mask = nullptr);
+
+    // Writes local matrices of all joints and updates the palette
+    void apply() const;
+
+private:
+    bool isCompatible(const Pose& other) const;
+    bool isCompatible(const PoseMask* mask) const;
+
+    std::weak_ptr<Armature> armature;
+    int jointCount = 0;
+    int stride = 0;
+    AlignedBuffer<float> values;
+
+    // Binding of the last sampled clip
+    std::shared_ptr<AnimationBinding> binding;
+    AlignedBuffer<float> clipPose;
+};
+
+}
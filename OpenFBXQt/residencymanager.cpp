@@ -0,0 +1,186 @@
+#include "residencymanager.h"
+#include <algorithm>
+
+namespace ofbxqt
+{
+
+void ResidencyManager::prepare(const Model& model)
+{
+    if (!isEnabled() || !model.data)
+    {
+        return;
+    }
+
+    model.data->keepCpuData = true;
+
+    const std::shared_ptr<Material>& material = model.material ? model.material : model.data->material;
+    if (!material)
+    {
+        return;
+    }
+
+    if (material->diffuseTexture)
+    {
+        material->diffuseTexture->keepCpuData = true;
+    }
+
+    if (material->normalTexture)
+    {
+        material->normalTexture->keepCpuData = true;
+    }
+}
+
+bool ResidencyManager::use(const Model& model)
+{
+    if (!model.isResident())
+    {
+        return false;
+    }
+
+    const std::shared_ptr<ModelData>& data = model.data;
+    if (!data)
+    {
+        return true;
+    }
+
+    data->lastUsedFrame = frame;
+    if (!data->residencyTracked)
+    {
+        data->residencyTracked = true;
+        buffers.append(data);
+    }
+
+    if (model.material)
+    {
+        track(model.material->diffuseTexture);
+        track(model.material->normalTexture);
+    }
+
+    return true;
+}
+
+void ResidencyManager::track(const std::shared_ptr<TextureInfo>& texture)
+{
+    if (!texture)
+    {
+        return;
+    }
+
+    texture->lastUsedFrame = frame;
+    if (!texture->residencyTracked)
+    {
+        texture->residencyTracked = true;
+        textures.append(texture);
+    }
+}
+
+void ResidencyManager::evict()
+{
+    QVector<Candidate> candidates;
+    residentBytes = 0;
+
+    // released and destroyed resources leave the lists, they are tracked again when they are used
+    for (int i = buffers.count() - 1; i >= 0; --i)
+    {
+        const std::shared_ptr<ModelData> data = buffers[i].lock();
+        if (!data || !data->isResident())
+        {
+            if (data)
+            {
+                data->residencyTracked = false;
+            }
+
+            buffers.remove(i);
+            continue;
+        }
+
+        Candidate candidate;
+        candidate.lastUsedFrame = data->lastUsedFrame;
+        candidate.size = data->getGpuSize();
+        residentBytes += candidate.size;
+
+        if (data->keepCpuData && data->lastUsedFrame != frame)
+        {
+            candidate.data = data;
+            candidates.append(candidate);
+        }
+    }
+
+    for (int i = textures.count() - 1; i >= 0; --i)
+    {
+        const std::shared_ptr<TextureInfo> texture = textures[i].lock();
+        if (!texture || !texture->texture)
+        {
+            if (texture)
+            {
+                texture->residencyTracked = false;
+            }
+
+            textures.remove(i);
+            continue;
+        }
+
+        Candidate candidate;
+        candidate.lastUsedFrame = texture->lastUsedFrame;
+        candidate.size = texture->gpuSize;
+        residentBytes += candidate.size;
+
+        if (texture->keepCpuData && texture->lastUsedFrame != frame)
+        {
+            candidate.texture = texture;
+            candidates.append(candidate);
+        }
+    }
+
+    if (!isEnabled() || residentBytes <= budget)
+    {
+        return;
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+    {
+        return a.lastUsedFrame < b.lastUsedFrame;
+    });
+
+    for (const Candidate& candidate : qAsConst(candidates))
+    {
+        if (residentBytes <= budget)
+        {
+            break;
+        }
+
+        const bool released = candidate.data ? candidate.data->releaseGL() : candidate.texture->releaseGL();
+        if (released)
+        {
+            residentBytes -= candidate.size;
+            ++releaseCount;
+        }
+    }
+}
+
+void ResidencyManager::clear()
+{
+    for (const std::weak_ptr<ModelData>& weakData : qAsConst(buffers))
+    {
+        const std::shared_ptr<ModelData> data = weakData.lock();
+        if (data)
+        {
+            data->residencyTracked = false;
+        }
+    }
+
+    for (const std::weak_ptr<TextureInfo>& weakTexture : qAsConst(textures))
+    {
+        const std::shared_ptr<TextureInfo> texture = weakTexture.lock();
+        if (texture)
+        {
+            texture->residencyTracked = false;
+        }
+    }
+
+    buffers.clear();
+    textures.clear();
+    residentBytes = 0;
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "model.h"
+
+namespace ofbxqt
+{
+
+// Keeps buffers and textures of models within a budget of video memory. Resources not drawn for the longest
+// time are released first, their models are uploaded again from CPU copies when they become visible.
+// Used from the OpenGL thread only
+class ResidencyManager
+{
+public:
+    // Negative means no limit, the default. CPU copies are kept only for models uploaded while a budget is set
+    void setBudget(const qint64 bytes) { budget = bytes; }
+    qint64 getBudget() const { return budget; }
+    bool isEnabled() const { return budget >= 0; }
+
+    qint64 getResidentBytes() const { return residentBytes; }
+    int getReleaseCount() const { return releaseCount; }
+
+    // Called before the model is queued for upload
+    void prepare(const Model& model);
+
+    void beginFrame() { ++frame; }
+    // Marks the resources of the model as used in this frame, returns false if they must be uploaded first
+    bool use(const Model& model);
+    // Releases least recently used resources until the budget is met, resources used in this frame are kept
+    void evict();
+
+    void clear();
+
+private:
+    struct Candidate
+    {
+        quint64 lastUsedFrame = 0;
+        qint64 size = 0;
+        std::shared_ptr<ModelData> data;
+        std::shared_ptr<TextureInfo> texture;
+    };
+
+    void track(const std::shared_ptr<TextureInfo>& texture);
+
+    qint64 budget = -1;
+    quint64 frame = 0;
+    qint64 residentBytes = 0;
+    int releaseCount = 0;
+
+    QVector<std::weak_ptr<ModelData>> buffers;
+    QVector<std::weak_ptr<TextureInfo>> textures;
+};
+
+}
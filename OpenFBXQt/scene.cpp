@@ -1,4 +1,8 @@
 #include "scene.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QtConcurrent>
+#include <QThread>
 #include <QtMath>
 #include <algorithm>
 #include <random>
@@ -9,11 +13,53 @@ namespace ofbxqt
 Scene::Scene(std::function<void()> onNeedUpdateCallback_)
     : onNeedUpdateCallback(onNeedUpdateCallback_)
 {
+    AnimationLodLevel level;
+
+    level.minScreenSize = 0.25f;
+    level.updateInterval = 1;
+    level.frozenLeafLevels = 0;
+    animationLodLevels.append(level);
+
+    level.minScreenSize = 0.1f;
+    level.updateInterval = 2;
+    level.frozenLeafLevels = 1;
+    animationLodLevels.append(level);
+
+    level.minScreenSize = 0.04f;
+    level.updateInterval = 4;
+    level.frozenLeafLevels = 2;
+    animationLodLevels.append(level);
+
+    level.minScreenSize = 0;
+    level.updateInterval = 8;
+    level.frozenLeafLevels = 3;
+    animationLodLevels.append(level);
+
+    offscreenAnimationLodLevel.updateInterval = 16;
+    offscreenAnimationLodLevel.frozenLeafLevels = 3;
+
+    loaderPool.setMaxThreadCount(QThread::idealThreadCount());
+
     resizeGL(100, 100);
 }
 
 Scene::~Scene()
 {
+    {
+        QMutexLocker locker(&stateMutex);
+        for (const std::weak_ptr<LoadTask>& weakTask : qAsConst(loadTasks))
+        {
+            const std::shared_ptr<LoadTask> task = weakTask.lock();
+            if (task)
+            {
+                task->cancel();
+            }
+        }
+    }
+
+    loaderPool.waitForDone();
+
+    setThreadedUpdate(false);
     clear();
 }
 
@@ -24,15 +70,26 @@ void Scene::initializeGL()
         return;
     }
 
-    initializedGL = true;
-
     initializeOpenGLFunctions();
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
 
-    for (std::shared_ptr<Model> model : qAsConst(topLevelModels))
     {
-        model->initializeGL();
+        // models added by asynchronous loads go either here or to pendingModels, never to both
+        QMutexLocker locker(&stateMutex);
+
+        initializedGL = true;
+
+        for (const std::shared_ptr<Model>& model : qAsConst(topLevelModels))
+        {
+            residency.prepare(*model);
+            uploadQueue.enqueue(model);
+        }
+
+        for (const std::shared_ptr<InstancedModel>& model : qAsConst(instancedModels))
+        {
+            model->initializeGL();
+        }
     }
 
     glClearColor(backgroundColor.redF(), backgroundColor.greenF(), backgroundColor.blueF(), 1.0);
@@ -40,11 +97,114 @@ void Scene::initializeGL()
 
 void Scene::paintGL()
 {
+    QElapsedTimer cpuTimer;
+    cpuTimer.start();
+
+    FrameStatistics statistics;
+    if (frameIntervalTimer.isValid())
+    {
+        statistics.frameIntervalMs = frameIntervalTimer.nsecsElapsed() / 1000000.0;
+    }
+
+    frameIntervalTimer.start();
+
+    if (gpuTimingEnabled != gpuTimerInitialized)
+    {
+        gpuTimerInitialized = gpuTimingEnabled;
+        if (!gpuTimingEnabled)
+        {
+            gpuTimer.destroyGL();
+        }
+        else if (!gpuTimer.initializeGL())
+        {
+            qWarning() << Q_FUNC_INFO << "no timer queries, GPU time is not measured";
+        }
+    }
+
+    gpuTimer.begin();
+
+    // an overlay painted with QPainter changes the state
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ZERO);
+
+    residency.beginFrame();
+    uploadPendingModels();
+
+    if (!updater)
+    {
+        bool playing = false;
+
+        {
+            // asynchronous loads add models from the loader pool
+            QMutexLocker locker(&stateMutex);
+            playing = updateAnimations();
+            publishSnapshot();
+        }
+
+        if (playing && onNeedUpdateCallback)
+        {
+            onNeedUpdateCallback();
+        }
+    }
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    for (std::shared_ptr<Model> model : qAsConst(topLevelModels))
+    const QMatrix4x4 viewProjection = simd::multiply(perspective, projection);
+    const SceneSnapshot& snapshot = snapshots.getReadBuffer();
+
+    modelProjectionMatrices.resize(snapshot.items.count());
+    simd::multiplyArray(viewProjection, snapshot.worldMatrices.constData(), modelProjectionMatrices.data(), snapshot.items.count());
+
+    for (int i = 0; i < snapshot.items.count(); ++i)
+    {
+        const SceneSnapshot::Item& item = snapshot.items[i];
+
+        QVector3D center;
+        float radius = 0;
+        item.model->getBoundingSphere(simd::multiply(projection, snapshot.worldMatrices[i]), center, radius);
+        if (!isInView(center, radius))
+        {
+            ++statistics.culledModels;
+            continue;
+        }
+
+        // released resources are uploaded again when the model becomes visible
+        if (!residency.use(*item.model))
+        {
+            residency.prepare(*item.model);
+            uploadQueue.enqueue(item.model);
+            continue;
+        }
+
+        const QMatrix4x4* palette = item.paletteSize > 0 ? snapshot.palettes.constData() + item.paletteOffset : nullptr;
+        item.model->paintGL(viewProjection, snapshot.worldMatrices[i], modelProjectionMatrices[i], palette, item.paletteSize, item.morphWeights, statistics);
+    }
+
+    for (const SceneSnapshot::InstancedItem& item : snapshot.instancedItems)
+    {
+        const std::shared_ptr<Model> model = item.model->getModel();
+        if (model && !residency.use(*model))
+        {
+            residency.prepare(*model);
+            uploadQueue.enqueue(model);
+            continue;
+        }
+
+        item.model->paintGL(viewProjection, item.instanceData, item.revision, item.time, statistics);
+    }
+
+    residency.evict();
+
+    gpuTimer.end();
+
+    statistics.gpuMs = gpuTimer.getLastMilliseconds();
+    statistics.cpuMs = cpuTimer.nsecsElapsed() / 1000000.0;
+    frameStatistics = statistics;
+
+    if (!uploadQueue.isEmpty() && onNeedUpdateCallback)
     {
-        model->paintGL(perspective * projection);
+        onNeedUpdateCallback();
     }
 }
 
@@ -52,8 +212,12 @@ void Scene::resizeGL(int width, int height)
 {
     const qreal aspect = qreal(width) / qreal(height ? height : 1);
 
-    perspective = QMatrix4x4();
-    perspective.perspective(viewingAngle, aspect, nearDistance, farDistance);
+    {
+        QMutexLocker locker(&stateMutex);
+
+        perspective = QMatrix4x4();
+        perspective.perspective(viewingAngle, aspect, nearDistance, farDistance);
+    }
 
     if (onNeedUpdateCallback)
     {
@@ -63,7 +227,10 @@ void Scene::resizeGL(int width, int height)
 
 void Scene::setProjection(const QMatrix4x4 &matrix)
 {
-    projection = matrix;
+    {
+        QMutexLocker locker(&stateMutex);
+        projection = matrix;
+    }
 
     if (onNeedUpdateCallback)
     {
@@ -86,42 +253,799 @@ void Scene::addModel(std::shared_ptr<Model> model)
 
     if (initializedGL)
     {
-        model->initializeGL();
+        // the caller may be on any thread, OpenGL resources are uploaded from the next frame
+        pendingModels.append(model);
     }
 
     topLevelModels.append(model);
 }
 
-FileInfo Scene::open(const QString &fileName, const OpenModelConfig config)
+void Scene::addFile(const FileInfo& fileInfo)
 {
-    const FileInfo fileInfo = Loader().open(fileName, config);
-
     files.append(std::shared_ptr<FileInfo>(new FileInfo(fileInfo)));
 
     for (const std::shared_ptr<Model>& model : qAsConst(fileInfo.topLevelModels))
     {
         addModel(model);
     }
+}
+
+bool Scene::uploadPendingModels()
+{
+    QVector<std::shared_ptr<Model>> models;
+
+    {
+        QMutexLocker locker(&stateMutex);
+        models.swap(pendingModels);
+    }
+
+    for (const std::shared_ptr<Model>& model : qAsConst(models))
+    {
+        residency.prepare(*model);
+        uploadQueue.enqueue(model);
+    }
+
+    if (uploadQueue.isEmpty())
+    {
+        return true;
+    }
+
+    return uploadQueue.process();
+}
+
+void Scene::setUploadBudget(const double milliseconds, const qint64 bytes)
+{
+    uploadQueue.setFrameBudget(milliseconds, bytes);
+}
+
+void Scene::setGpuMemoryBudget(const qint64 bytes)
+{
+    residency.setBudget(bytes);
 
     if (onNeedUpdateCallback)
     {
         onNeedUpdateCallback();
     }
+}
+
+void Scene::addInstancedModel(std::shared_ptr<InstancedModel> model)
+{
+    if (!model)
+    {
+        qCritical() << Q_FUNC_INFO << "model is null";
+        return;
+    }
+
+    {
+        QMutexLocker locker(&stateMutex);
+
+        if (initializedGL)
+        {
+            model->initializeGL();
+        }
+
+        instancedModels.append(model);
+    }
+
+    requestUpdate();
+}
+
+void Scene::removeInstancedModel(std::shared_ptr<InstancedModel> model)
+{
+    {
+        QMutexLocker locker(&stateMutex);
+        instancedModels.removeAll(model);
+    }
+
+    requestUpdate();
+}
+
+FileInfo Scene::open(const QString &fileName, const OpenModelConfig config)
+{
+    const FileInfo fileInfo = Loader(storage).open(fileName, config);
+
+    {
+        QMutexLocker locker(&stateMutex);
+        addFile(fileInfo);
+    }
+
+    requestUpdate();
 
     return fileInfo;
 }
 
-void Scene::clear()
+std::shared_ptr<LoadTask> Scene::openAsync(const QString& fileName, const OpenModelConfig config, std::function<void(const FileInfo&)> onFinished)
 {
-    topLevelModels.clear();
-    files.clear();
-    DataStorage::getInstance().data.clear();
-    DataStorage::getInstance().textures.clear();
+    const std::shared_ptr<LoadTask> task = std::make_shared<LoadTask>();
 
-    if (onNeedUpdateCallback)
+    {
+        QMutexLocker locker(&stateMutex);
+
+        for (int i = loadTasks.count() - 1; i >= 0; --i)
+        {
+            if (loadTasks[i].expired())
+            {
+                loadTasks.remove(i);
+            }
+        }
+
+        loadTasks.append(task);
+    }
+
+    const std::weak_ptr<bool> alive = aliveToken;
+
+    QtConcurrent::run(&loaderPool, [this, task, fileName, config, onFinished, alive]()
+    {
+        const FileInfo fileInfo = Loader(storage).open(fileName, config, task.get());
+
+        // the destructor of the scene waits for the pool, so the scene is alive here
+        if (!task->isCancelRequested())
+        {
+            QMutexLocker locker(&stateMutex);
+            addFile(fileInfo);
+        }
+
+        task->finish(fileInfo);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [this, task, onFinished, alive]()
+        {
+            if (alive.lock())
+            {
+                requestUpdate();
+            }
+
+            if (onFinished)
+            {
+                onFinished(task->getFileInfo());
+            }
+        }, Qt::QueuedConnection);
+    });
+
+    return task;
+}
+
+std::shared_ptr<AnimationPlayer> Scene::playAnimation(std::shared_ptr<AnimationClip> clip)
+{
+    if (!clip)
+    {
+        qCritical() << Q_FUNC_INFO << "clip is null";
+        return nullptr;
+    }
+
+    QMutexLocker locker(&stateMutex);
+
+    std::shared_ptr<AnimationPlayer> player = getAnimationPlayer(clip);
+    if (!player)
+    {
+        player = std::shared_ptr<AnimationPlayer>(new AnimationPlayer(clip, [this]()
+        {
+            requestUpdate();
+        }));
+        animationPlayers.append(player);
+    }
+
+    player->play();
+
+    return player;
+}
+
+std::shared_ptr<AnimationPlayer> Scene::getAnimationPlayer(std::shared_ptr<AnimationClip> clip) const
+{
+    for (const std::shared_ptr<AnimationPlayer>& player : animationPlayers)
+    {
+        if (player->getClip() == clip)
+        {
+            return player;
+        }
+    }
+
+    return nullptr;
+}
+
+bool Scene::updateAnimations()
+{
+    const double deltaSeconds = animationTimer.isValid() ? animationTimer.restart() / 1000.0 : 0.0;
+    if (!animationTimer.isValid())
+    {
+        animationTimer.start();
+    }
+
+    updateAnimationLod();
+
+    bool playing = false;
+
+    for (const std::shared_ptr<AnimationPlayer>& player : qAsConst(animationPlayers))
+    {
+        player->advance(deltaSeconds);
+        playing |= player->isPlaying() || player->isApplyPending();
+    }
+
+    for (const std::shared_ptr<InstancedModel>& model : qAsConst(instancedModels))
+    {
+        model->advance(deltaSeconds);
+        playing |= model->isPlaying();
+    }
+
+    // interpolated palettes need more frames to reach the last evaluation
+    for (const std::shared_ptr<Model>& model : qAsConst(topLevelModels))
+    {
+        playing |= model->armature && model->armature->lodStep < model->armature->lodUpdateInterval;
+    }
+
+    if (!playing)
+    {
+        // do not count idle time when playback starts again
+        animationTimer.invalidate();
+    }
+
+    return playing;
+}
+
+void Scene::setAnimationLod(const QVector<AnimationLodLevel>& levels, const AnimationLodLevel& offscreenLevel)
+{
+    {
+        QMutexLocker locker(&stateMutex);
+
+        animationLodLevels = levels;
+        offscreenAnimationLodLevel = offscreenLevel;
+    }
+
+    requestUpdate();
+}
+
+void Scene::setAnimationLodEnabled(const bool enabled)
+{
+    {
+        QMutexLocker locker(&stateMutex);
+        animationLodEnabled = enabled;
+    }
+
+    requestUpdate();
+}
+
+void Scene::updateAnimationLod()
+{
+    ++animationLodFrame;
+
+    // <update interval, next phase>
+    QHash<int, int> phases;
+
+    for (const std::shared_ptr<Model>& model : qAsConst(topLevelModels))
+    {
+        if (!model->armature)
+        {
+            continue;
+        }
+
+        Armature& armature = *model->armature;
+
+        bool offscreen = false;
+        const AnimationLodLevel level = animationLodEnabled ? getAnimationLodLevel(*model, offscreen) : AnimationLodLevel();
+
+        armature.lodUpdateInterval = qMax(1, level.updateInterval);
+        armature.lodFrozenLeafLevels = qMax(0, level.frozenLeafLevels);
+        armature.lodOffscreen = offscreen;
+
+        // armatures with the same interval are evaluated on different frames, so the cost of a frame stays flat
+        armature.lodPhase = phases[armature.lodUpdateInterval]++;
+        armature.lodSkipUpdate = (animationLodFrame + armature.lodPhase) % armature.lodUpdateInterval != 0;
+    }
+}
+
+AnimationLodLevel Scene::getAnimationLodLevel(const Model& model, bool& offscreen) const
+{
+    offscreen = false;
+
+    if (animationLodLevels.isEmpty())
+    {
+        return AnimationLodLevel();
+    }
+
+    QVector3D center;
+    float radius = 0;
+    model.getBoundingSphere(simd::multiply(projection, model.getWorldMatrix()), center, radius);
+
+    if (!isInView(center, radius))
+    {
+        offscreen = true;
+        return offscreenAnimationLodLevel;
+    }
+
+    const float depth = qMax(-center.z(), float(nearDistance));
+    const float screenSize = radius * perspective(1, 1) / depth;
+
+    for (const AnimationLodLevel& level : animationLodLevels)
+    {
+        if (screenSize >= level.minScreenSize)
+        {
+            return level;
+        }
+    }
+
+    return animationLodLevels.last();
+}
+
+bool Scene::isInView(const QVector3D& center, const float radius) const
+{
+    // the camera looks along -Z in view space
+    const float distance = -center.z();
+    if (distance + radius < nearDistance)
+    {
+        return false;
+    }
+
+    const float depth = qMax(distance, float(nearDistance));
+
+    return qAbs(center.x()) - radius <= depth / perspective(0, 0) && qAbs(center.y()) - radius <= depth / perspective(1, 1);
+}
+
+// Splits an affine matrix to translation, rotation and scale, a mirroring is kept in the scale. Shear is dropped
+static Armature::LodTransform decomposeTRS(const QMatrix4x4& matrix)
+{
+    Armature::LodTransform result;
+    result.translation = matrix.column(3).toVector3D();
+
+    const QVector3D axes[3] = { matrix.column(0).toVector3D(), matrix.column(1).toVector3D(), matrix.column(2).toVector3D() };
+    result.scale = QVector3D(axes[0].length(), axes[1].length(), axes[2].length());
+    if (QVector3D::dotProduct(QVector3D::crossProduct(axes[0], axes[1]), axes[2]) < 0)
+    {
+        result.scale.setX(-result.scale.x());
+    }
+
+    QMatrix3x3 rotationMatrix;
+    for (int column = 0; column < 3; ++column)
+    {
+        const float length = result.scale[column];
+        const QVector3D axis = qFuzzyIsNull(length) ? QVector3D() : axes[column] / length;
+        rotationMatrix(0, column) = axis.x();
+        rotationMatrix(1, column) = axis.y();
+        rotationMatrix(2, column) = axis.z();
+    }
+
+    result.rotation = QQuaternion::fromRotationMatrix(rotationMatrix);
+
+    return result;
+}
+
+const QVector<QMatrix4x4>& Scene::interpolateLodPalette(Armature& armature)
+{
+    const QVector<QMatrix4x4>& target = armature.jointsMatrices;
+
+    // nothing to smooth for armatures evaluated every frame, and nobody sees the ones out of the view
+    if (armature.lodUpdateInterval <= 1 || armature.lodOffscreen)
+    {
+        armature.lodFrom.clear();
+        armature.lodTo.clear();
+        armature.lodShownMatrices.clear();
+        armature.lodStep = armature.lodUpdateInterval;
+        return target;
+    }
+
+    if (armature.lodShownMatrices.count() != target.count())
+    {
+        armature.lodShownMatrices = target;
+        armature.lodStep = armature.lodUpdateInterval;
+    }
+
+    // the palette follows evaluations one interval behind, so it never jumps. A blend of whole matrices
+    // shrinks and shears rotating joints, so the parts are blended, decomposed once per evaluation
+    if (!armature.lodSkipUpdate && armature.lodPaletteChanged)
+    {
+        armature.lodPaletteChanged = false;
+        armature.lodFrom.resize(target.count());
+        armature.lodTo.resize(target.count());
+        for (int i = 0; i < target.count(); ++i)
+        {
+            armature.lodFrom[i] = decomposeTRS(armature.lodShownMatrices[i]);
+            armature.lodTo[i] = decomposeTRS(target[i]);
+        }
+
+        armature.lodStep = 0;
+    }
+
+    armature.lodStep = qMin(armature.lodStep + 1, armature.lodUpdateInterval);
+
+    if (armature.lodStep >= armature.lodUpdateInterval)
+    {
+        // shares the data, the next evaluation starts from here
+        armature.lodShownMatrices = target;
+        return target;
+    }
+
+    const float t = float(armature.lodStep) / armature.lodUpdateInterval;
+    for (int i = 0; i < target.count(); ++i)
+    {
+        const Armature::LodTransform& from = armature.lodFrom[i];
+        const Armature::LodTransform& to = armature.lodTo[i];
+
+        armature.lodShownMatrices[i] = simd::composeTRS(from.translation + (to.translation - from.translation) * t,
+                                                        QQuaternion::nlerp(from.rotation, to.rotation, t),
+                                                        from.scale + (to.scale - from.scale) * t);
+    }
+
+    return armature.lodShownMatrices;
+}
+
+void Scene::publishSnapshot()
+{
+    SceneSnapshot& snapshot = snapshots.getWriteBuffer();
+
+    snapshot.items.resize(topLevelModels.count());
+    snapshot.worldMatrices.resize(topLevelModels.count());
+    snapshot.palettes.resize(0);
+
+    for (int i = 0; i < topLevelModels.count(); ++i)
+    {
+        const std::shared_ptr<Model>& model = topLevelModels[i];
+        SceneSnapshot::Item& item = snapshot.items[i];
+
+        item.model = model;
+        snapshot.worldMatrices[i] = model->getWorldMatrix();
+        item.paletteOffset = snapshot.palettes.count();
+        item.paletteSize = 0;
+        item.morphWeights = model->getMorphWeights();
+
+        if (model->armature)
+        {
+            model->armature->update();
+
+            const QVector<QMatrix4x4>& matrices = interpolateLodPalette(*model->armature);
+            snapshot.palettes.append(matrices);
+            item.paletteSize = matrices.count();
+        }
+    }
+
+    snapshot.instancedItems.resize(instancedModels.count());
+
+    for (int i = 0; i < instancedModels.count(); ++i)
+    {
+        const std::shared_ptr<InstancedModel>& model = instancedModels[i];
+        SceneSnapshot::InstancedItem& item = snapshot.instancedItems[i];
+
+        item.model = model;
+        item.instanceData = model->instanceData; // shared until the model changes its instances
+        item.revision = model->revision;
+        item.time = model->time;
+    }
+
+    snapshots.publish();
+}
+
+void Scene::notifyFrameReady()
+{
+    if (!onNeedUpdateCallback || !frameNotifyPending->testAndSetOrdered(0, 1))
+    {
+        return;
+    }
+
+    // the callback usually repaints a widget, so it is called in the GUI thread
+    const std::weak_ptr<QAtomicInt> pending = frameNotifyPending;
+    const std::function<void()> callback = onNeedUpdateCallback;
+    QMetaObject::invokeMethod(QCoreApplication::instance(), [pending, callback]()
+    {
+        const std::shared_ptr<QAtomicInt> pending_ = pending.lock();
+        if (pending_)
+        {
+            pending_->storeRelease(0);
+            callback();
+        }
+    }, Qt::QueuedConnection);
+}
+
+MemoryReport Scene::memoryReport()
+{
+    // the update thread resizes armature arrays and may change children, so they are read under the lock too
+    QMutexLocker locker(&stateMutex);
+
+    QVector<std::shared_ptr<Model>> models;
+    QVector<std::shared_ptr<AnimationClip>> clips;
+
+    for (const std::shared_ptr<FileInfo>& file : qAsConst(files))
+    {
+        models += file->allModels;
+        clips += file->animationClips;
+    }
+
+    models += topLevelModels;
+    models += pendingModels;
+    const QVector<std::shared_ptr<InstancedModel>>& instanced = instancedModels;
+
+    MemoryReport report;
+    QHash<const ModelData*, int> dataIndices;
+    QHash<const TextureInfo*, int> textureIndices;
+    QHash<const Armature*, int> armatureIndices;
+    QHash<const void*, int> animationIndices;
+    QSet<const Model*> visitedModels;
+    QSet<const Material*> visitedMaterials;
+    QSet<const QFile*> mappedFiles;
+
+    auto addTexture = [&](const std::shared_ptr<TextureInfo>& texture)
+    {
+        if (!texture)
+        {
+            return;
+        }
+
+        if (textureIndices.contains(texture.get()))
+        {
+            ++report.textures[textureIndices.value(texture.get())].users;
+            return;
+        }
+
+        MemoryReport::TextureEntry entry;
+        entry.fileName = texture->getFileName();
+        entry.users = 1;
+        {
+            // a loader may still be joining a texture shared with the scene
+            QMutexLocker locker(&texture->decodingMutex);
+            entry.imageBytes = texture->image.getSizeInBytes();
+        }
+        entry.gpuBytes = texture->texture ? texture->gpuSize : 0;
+
+        textureIndices.insert(texture.get(), report.textures.count());
+        report.textures.append(entry);
+    };
+
+    auto addMaterial = [&](const std::shared_ptr<Material>& material)
+    {
+        if (!material || visitedMaterials.contains(material.get()))
+        {
+            return;
+        }
+
+        visitedMaterials.insert(material.get());
+        addTexture(material->diffuseTexture);
+        addTexture(material->normalTexture);
+    };
+
+    auto addArmature = [&](const std::shared_ptr<Armature>& armature, const Model& model)
+    {
+        if (!armature)
+        {
+            return;
+        }
+
+        if (armatureIndices.contains(armature.get()))
+        {
+            ++report.armatures[armatureIndices.value(armature.get())].users;
+            return;
+        }
+
+        MemoryReport::ArmatureEntry entry;
+        entry.name = model.getName();
+        entry.users = 1;
+        entry.jointCount = armature->allJoints.count();
+
+        const int matrixCount = armature->sourceMatrices.count() + armature->inverseSourceMatrices.count() + armature->localMatrices.count()
+                + armature->restLocalMatrices.count()
+                + armature->jointsMatrices.count() + armature->lodShownMatrices.count();
+        entry.cpuBytes = qint64(matrixCount) * int(sizeof(QMatrix4x4))
+                + qint64(armature->parentIndices.count() + armature->subtreeEnds.count()) * int(sizeof(int))
+                + armature->dirtyFlags.count() + armature->jointHeights.count()
+                + qint64(armature->lodFrom.count() + armature->lodTo.count()) * int(sizeof(Armature::LodTransform));
+
+        for (const std::shared_ptr<Joint>& joint : qAsConst(armature->allJoints))
+        {
+            entry.cpuBytes += int(sizeof(Joint)) + joint->getName().size() * int(sizeof(QChar));
+        }
+
+        armatureIndices.insert(armature.get(), report.armatures.count());
+        report.armatures.append(entry);
+    };
+
+    auto addAnimation = [&](const void* key, const QString& name, const qint64 cpuBytes, const qint64 gpuBytes)
+    {
+        if (animationIndices.contains(key))
+        {
+            ++report.animations[animationIndices.value(key)].users;
+            return;
+        }
+
+        MemoryReport::AnimationEntry entry;
+        entry.name = name;
+        entry.users = 1;
+        entry.cpuBytes = cpuBytes;
+        entry.gpuBytes = gpuBytes;
+
+        animationIndices.insert(key, report.animations.count());
+        report.animations.append(entry);
+    };
+
+    auto getGpuBytes = [](const ModelData& data)
+    {
+        return (data.vertexBuffer.isCreated() ? qint64(data.vertexCount) * data.vertexStride : 0)
+                + (data.indexBuffer.isCreated() ? qint64(data.indexCount) * data.indexStride : 0)
+                + (data.morphTexture ? qint64(data.morphTexture->width()) * data.morphTexture->height() * 4 * int(sizeof(float)) : 0);
+    };
+
+    std::function<void(const std::shared_ptr<Model>&)> addModel = [&](const std::shared_ptr<Model>& model)
+    {
+        if (!model || visitedModels.contains(model.get()))
+        {
+            return;
+        }
+
+        visitedModels.insert(model.get());
+
+        if (model->morphWeightsTexture)
+        {
+            report.morphWeightGpuBytes += qint64(model->morphWeightsTexture->width()) * int(sizeof(float));
+        }
+
+        addMaterial(model->material);
+        addArmature(model->armature ? model->armature : (model->data ? model->data->armature : nullptr), *model);
+
+        const std::shared_ptr<ModelData>& data = model->data;
+        if (data)
+        {
+            addMaterial(data->material);
+
+            if (dataIndices.contains(data.get()))
+            {
+                ++report.modelData[dataIndices.value(data.get())].users;
+            }
+            else
+            {
+                MemoryReport::ModelDataEntry entry;
+                entry.name = data->name;
+                entry.users = 1;
+
+                // the arrays reference the mapping of a model cache entry until upload
+                if (data->mappedFile)
+                {
+                    entry.mappedBytes = data->vertexData.size() + data->indexData.size();
+                    mappedFiles.insert(data->mappedFile.get());
+                }
+                else
+                {
+                    entry.vertexBytes = data->vertexData.size();
+                    entry.indexBytes = data->indexData.size();
+                }
+
+                entry.morphBytes = data->morphData.count() * qint64(sizeof(float));
+                entry.gpuVertexBytes = data->vertexBuffer.isCreated() ? qint64(data->vertexCount) * data->vertexStride : 0;
+                entry.gpuIndexBytes = data->indexBuffer.isCreated() ? qint64(data->indexCount) * data->indexStride : 0;
+                entry.gpuMorphBytes = getGpuBytes(*data) - entry.gpuVertexBytes - entry.gpuIndexBytes;
+
+                dataIndices.insert(data.get(), report.modelData.count());
+                report.modelData.append(entry);
+            }
+        }
+
+        for (const std::shared_ptr<Model>& child : qAsConst(model->children))
+        {
+            addModel(child);
+        }
+    };
+
+    for (const std::shared_ptr<Model>& model : qAsConst(models))
+    {
+        addModel(model);
+    }
+
+    for (const std::shared_ptr<AnimationClip>& clip : qAsConst(clips))
+    {
+        addAnimation(clip.get(), clip->getName(), clip->getKeysSize(), 0);
+    }
+
+    for (const std::shared_ptr<InstancedModel>& model : qAsConst(instanced))
+    {
+        addModel(model->model);
+
+        report.instanceCpuBytes += model->instanceData.count() * qint64(sizeof(float));
+        report.instanceGpuBytes += model->instanceBuffer.isCreated() ? model->instanceBuffer.size() : 0;
+
+        const std::shared_ptr<BakedAnimation>& animation = model->animation;
+        if (animation)
+        {
+            const qint64 gpuBytes = animation->texture ? qint64(animation->getTextureWidth()) * animation->getTextureHeight() * 4 * int(sizeof(float)) : 0;
+            addAnimation(animation.get(), animation->clip ? animation->clip->getName() : QString(),
+                         animation->texels.count() * qint64(sizeof(float)), gpuBytes);
+        }
+    }
+
+    // what only the store of the scene keeps alive
+    {
+        QMutexLocker locker(&storage.mutex);
+
+        for (const auto& texture : storage.textures)
+        {
+            if (texture.second && !textureIndices.contains(texture.second.get()))
+            {
+                QMutexLocker textureLocker(&texture.second->decodingMutex);
+                ++report.leftoverCount;
+                report.leftoverCpuBytes += texture.second->image.getSizeInBytes();
+                report.leftoverGpuBytes += texture.second->texture ? texture.second->gpuSize : 0;
+            }
+        }
+    }
+
+    for (const MemoryReport::ModelDataEntry& entry : qAsConst(report.modelData))
+    {
+        report.cpuBytes += entry.getCpuBytes();
+        report.gpuBytes += entry.getGpuBytes();
+    }
+
+    for (const MemoryReport::TextureEntry& entry : qAsConst(report.textures))
+    {
+        report.cpuBytes += entry.imageBytes;
+        report.gpuBytes += entry.gpuBytes;
+    }
+
+    for (const MemoryReport::ArmatureEntry& entry : qAsConst(report.armatures))
+    {
+        report.cpuBytes += entry.cpuBytes;
+    }
+
+    for (const MemoryReport::AnimationEntry& entry : qAsConst(report.animations))
+    {
+        report.cpuBytes += entry.cpuBytes;
+        report.gpuBytes += entry.gpuBytes;
+    }
+
+    report.cpuBytes += report.instanceCpuBytes + report.leftoverCpuBytes;
+    report.gpuBytes += report.morphWeightGpuBytes + report.instanceGpuBytes + report.leftoverGpuBytes;
+
+    for (const QFile* file : qAsConst(mappedFiles))
+    {
+        report.mappedBytes += file->size();
+    }
+
+    return report;
+}
+
+void Scene::setThreadedUpdate(const bool enabled)
+{
+    if (enabled == (updater != nullptr))
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        updater.reset(new SceneUpdater(*this));
+        updater->start();
+    }
+    else
+    {
+        updater->stop();
+        updater.reset();
+    }
+}
+
+void Scene::requestUpdate()
+{
+    if (updater)
+    {
+        updater->wake();
+    }
+    else if (onNeedUpdateCallback)
     {
         onNeedUpdateCallback();
     }
 }
 
+void Scene::clear()
+{
+    {
+        QMutexLocker locker(&stateMutex);
+
+        animationPlayers.clear();
+        topLevelModels.clear();
+        pendingModels.clear();
+        uploadQueue.clear();
+        residency.clear();
+        instancedModels.clear();
+        files.clear();
+
+        // snapshots keep models alive, release them here and not in the update thread
+        snapshots.reset();
+
+        // loads still running keep the textures they use, later files of the scene no longer share them
+        storage.clear();
+    }
+
+    requestUpdate();
+}
+
 }
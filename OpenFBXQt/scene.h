@@ -1,16 +1,62 @@
 #pragma once
 
 #include "model.h"
+#include "instancedmodel.h"
 #include "loader.h"
+#include "loadtask.h"
+#include "animationplayer.h"
+#include "sceneupdater.h"
+#include "triplebuffer.h"
+#include "uploadqueue.h"
+#include "residencymanager.h"
+#include "framestatistics.h"
+#include "memoryreport.h"
 #include <QOpenGLFunctions>
+#include <QElapsedTimer>
+#include <QThreadPool>
 #include <QColor>
 
 namespace ofbxqt
 {
 
+// Everything needed to draw a frame, so drawing does not read models and armatures
+struct SceneSnapshot
+{
+    struct Item
+    {
+        std::shared_ptr<Model> model;
+        int paletteOffset = 0;
+        int paletteSize = 0;
+        QVector<float> morphWeights; // shared with the model until it changes a weight
+    };
+
+    struct InstancedItem
+    {
+        std::shared_ptr<InstancedModel> model;
+        QVector<float> instanceData;
+        quint64 revision = 0;
+        double time = 0;
+    };
+
+    QVector<Item> items;
+    QVector<QMatrix4x4> worldMatrices; // one per item
+    QVector<QMatrix4x4> palettes;
+    QVector<InstancedItem> instancedItems;
+};
+
+// Animation level of detail for armatures by the size of their models on screen
+struct AnimationLodLevel
+{
+    float minScreenSize = 0; // diameter of the bounding sphere relative to the viewport height
+    int updateInterval = 1; // the armature is evaluated every Nth frame, palettes are interpolated in between
+    int frozenLeafLevels = 0; // joints this close to leaves, like fingers and face, keep their pose
+};
+
 class Scene : protected QOpenGLFunctions
 {
 public:
+    friend class SceneUpdater;
+
     Scene(std::function<void()> onNeedUpdateCallback);
     ~Scene();
 
@@ -21,15 +67,72 @@ public:
     QMatrix4x4 getProjection() const;
 
     FileInfo open(const QString& fileName, const OpenModelConfig config = OpenModelConfig());
+    // Loads the file on a worker thread, models are added to the scene when it is done and initialized
+    // for OpenGL at the next frame. onFinished is called in the GUI thread, also for a canceled task
+    std::shared_ptr<LoadTask> openAsync(const QString& fileName, const OpenModelConfig config = OpenModelConfig(),
+                                        std::function<void(const FileInfo&)> onFinished = nullptr);
     void clear();
 
+    // Asynchronous loads append to these lists, use them only while no load is running or while holding getStateMutex()
     const QVector<std::shared_ptr<Model>>& getTopLevelModels() const { return topLevelModels; }
     const QVector<std::shared_ptr<ofbxqt::FileInfo>>& getFiles() { return files; }
 
+    void addInstancedModel(std::shared_ptr<InstancedModel> model);
+    void removeInstancedModel(std::shared_ptr<InstancedModel> model);
+    const QVector<std::shared_ptr<InstancedModel>>& getInstancedModels() const { return instancedModels; }
+
+    std::shared_ptr<AnimationPlayer> playAnimation(std::shared_ptr<AnimationClip> clip);
+    std::shared_ptr<AnimationPlayer> getAnimationPlayer(std::shared_ptr<AnimationClip> clip) const;
+    const QVector<std::shared_ptr<AnimationPlayer>>& getAnimationPlayers() const { return animationPlayers; }
+
+    // Animations and matrices are evaluated on a separate thread. While it is enabled, models, joints
+    // and animation players may be changed only while holding getStateMutex(), Scene methods lock it themselves
+    void setThreadedUpdate(const bool enabled);
+    bool isThreadedUpdate() const { return updater != nullptr; }
+    QMutex& getStateMutex() { return stateMutex; }
+
+    // Levels are ordered by minScreenSize from the largest, the first level not larger than the model is used.
+    // Models out of the view use offscreenLevel
+    void setAnimationLod(const QVector<AnimationLodLevel>& levels, const AnimationLodLevel& offscreenLevel);
+    void setAnimationLodEnabled(const bool enabled);
+    bool isAnimationLodEnabled() const { return animationLodEnabled; }
+
+    // Buffers and textures of new models are uploaded over several frames within this budget, a model
+    // appears when all its data is uploaded. Negative values mean no limit
+    void setUploadBudget(const double milliseconds, const qint64 bytes);
+    int getPendingUploadCount() const { return uploadQueue.count(); }
+
+    // Video memory for buffers and textures of models, negative means no limit. Over the budget, resources of
+    // models not visible for the longest time are released and uploaded again when the models become visible
+    void setGpuMemoryBudget(const qint64 bytes);
+    qint64 getGpuMemoryBudget() const { return residency.getBudget(); }
+    qint64 getResidentGpuMemory() const { return residency.getResidentBytes(); }
+
+    // CPU and GPU memory by asset. Called in the OpenGL thread, GPU sizes are of the resources created so far
+    MemoryReport memoryReport();
+
+    // Counters and timings of the last drawn frame
+    const FrameStatistics& getFrameStatistics() const { return frameStatistics; }
+    // GPU time of frames is measured with timer queries when the context supports them
+    void setGpuTimingEnabled(const bool enabled) { gpuTimingEnabled = enabled; }
+    bool isGpuTimingEnabled() const { return gpuTimingEnabled; }
+
+    // Schedules a new frame after models, joints or animation players were changed
+    void requestUpdate();
+
     void paintGL();
 
 private:
     void addModel(std::shared_ptr<Model> model);
+    void addFile(const FileInfo& fileInfo);
+    bool uploadPendingModels(); // returns true when everything is uploaded
+    bool updateAnimations(); // returns true while something is playing
+    void updateAnimationLod();
+    AnimationLodLevel getAnimationLodLevel(const Model& model, bool& offscreen) const;
+    bool isInView(const QVector3D& center, const float radius) const; // sphere in view space
+    static const QVector<QMatrix4x4>& interpolateLodPalette(Armature& armature);
+    void publishSnapshot();
+    void notifyFrameReady();
 
     bool initializedGL = false;
 
@@ -44,6 +147,33 @@ private:
     QColor backgroundColor = QColor(64, 64, 64);
     QVector<std::shared_ptr<ofbxqt::FileInfo>> files;
     QVector<std::shared_ptr<Model>> topLevelModels;
+    QVector<std::shared_ptr<Model>> pendingModels; // added after initializeGL(), queued for upload in paintGL()
+    UploadQueue uploadQueue; // used in the OpenGL thread only
+    ResidencyManager residency; // used in the OpenGL thread only
+    FrameStatistics frameStatistics;
+    QElapsedTimer frameIntervalTimer;
+    GpuFrameTimer gpuTimer; // used in the OpenGL thread only
+    bool gpuTimingEnabled = false;
+    bool gpuTimerInitialized = false;
+    QVector<std::shared_ptr<InstancedModel>> instancedModels;
+    QVector<std::shared_ptr<AnimationPlayer>> animationPlayers;
+    QElapsedTimer animationTimer;
+
+    bool animationLodEnabled = true;
+    QVector<AnimationLodLevel> animationLodLevels;
+    AnimationLodLevel offscreenAnimationLodLevel;
+    quint64 animationLodFrame = 0;
+
+    QMutex stateMutex;
+    TripleBuffer<SceneSnapshot> snapshots;
+    QVector<QMatrix4x4> modelProjectionMatrices; // for the snapshot being drawn
+    std::unique_ptr<SceneUpdater> updater;
+    std::shared_ptr<QAtomicInt> frameNotifyPending = std::make_shared<QAtomicInt>(0);
+    std::shared_ptr<bool> aliveToken = std::make_shared<bool>(true); // expires with the scene
+
+    DataStorage storage; // textures shared between the files of this scene
+    QThreadPool loaderPool; // files are loaded in parallel
+    QVector<std::weak_ptr<LoadTask>> loadTasks;
     QMatrix4x4 perspective;
     QMatrix4x4 projection;
 };
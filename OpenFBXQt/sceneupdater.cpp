@@ -0,0 +1,73 @@
+#include "sceneupdater.h"
+#include "scene.h"
+#include <QElapsedTimer>
+
+namespace ofbxqt
+{
+
+SceneUpdater::SceneUpdater(Scene& scene_)
+    : scene(scene_)
+{
+
+}
+
+SceneUpdater::~SceneUpdater()
+{
+    stop();
+}
+
+void SceneUpdater::wake()
+{
+    QMutexLocker locker(&wakeMutex);
+    wakeRequested = true;
+    wakeCondition.wakeAll();
+}
+
+void SceneUpdater::stop()
+{
+    requestInterruption();
+    wake();
+    wait();
+}
+
+void SceneUpdater::run()
+{
+    QElapsedTimer frameTimer;
+
+    while (!isInterruptionRequested())
+    {
+        frameTimer.start();
+
+        bool playing = false;
+
+        {
+            QMutexLocker locker(&scene.stateMutex);
+            playing = scene.updateAnimations();
+            scene.publishSnapshot();
+        }
+
+        scene.notifyFrameReady();
+
+        QMutexLocker locker(&wakeMutex);
+        if (!wakeRequested && !isInterruptionRequested())
+        {
+            if (playing)
+            {
+                const qint64 frameInterval = qMax(qint64(1), qint64(1000.0 / scene.maxFps));
+                const qint64 remaining = frameInterval - frameTimer.elapsed();
+                if (remaining > 0)
+                {
+                    wakeCondition.wait(&wakeMutex, (unsigned long)remaining);
+                }
+            }
+            else
+            {
+                wakeCondition.wait(&wakeMutex);
+            }
+        }
+
+        wakeRequested = false;
+    }
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace ofbxqt
+{
+
+class Scene;
+
+// Advances animations and publishes frame snapshots of the scene outside of the GUI thread
+class SceneUpdater : public QThread
+{
+public:
+    SceneUpdater(Scene& scene);
+    ~SceneUpdater();
+
+    // Evaluates a new frame as soon as possible
+    void wake();
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    Scene& scene;
+
+    QMutex wakeMutex;
+    QWaitCondition wakeCondition;
+    bool wakeRequested = false;
+};
+
+}
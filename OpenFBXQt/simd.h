@@ -0,0 +1,135 @@
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OFBXQT_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OFBXQT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#include <cmath>
+
+namespace ofbxqt
+{
+
+namespace simd
+{
+
+static const int Width = 4;
+
+#if defined(OFBXQT_SIMD_SSE2)
+
+typedef __m128 float4;
+
+inline float4 load(const float* p) { return _mm_load_ps(p); }
+inline void store(float* p, const float4 v) { _mm_store_ps(p, v); }
+inline float4 loadUnaligned(const float* p) { return _mm_loadu_ps(p); }
+inline void storeUnaligned(float* p, const float4 v) { _mm_storeu_ps(p, v); }
+inline float4 set1(const float f) { return _mm_set1_ps(f); }
+inline float4 add(const float4 a, const float4 b) { return _mm_add_ps(a, b); }
+inline float4 sub(const float4 a, const float4 b) { return _mm_sub_ps(a, b); }
+inline float4 mul(const float4 a, const float4 b) { return _mm_mul_ps(a, b); }
+inline float4 div(const float4 a, const float4 b) { return _mm_div_ps(a, b); }
+inline float4 sqrt(const float4 a) { return _mm_sqrt_ps(a); }
+// a with the sign flipped in the lanes where sign is negative
+inline float4 mulSign(const float4 a, const float4 sign) { return _mm_xor_ps(a, _mm_and_ps(sign, _mm_set1_ps(-0.0f))); }
+
+#elif defined(OFBXQT_SIMD_NEON)
+
+typedef float32x4_t float4;
+
+inline float4 load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, const float4 v) { vst1q_f32(p, v); }
+inline float4 loadUnaligned(const float* p) { return vld1q_f32(p); }
+inline void storeUnaligned(float* p, const float4 v) { vst1q_f32(p, v); }
+inline float4 set1(const float f) { return vdupq_n_f32(f); }
+inline float4 add(const float4 a, const float4 b) { return vaddq_f32(a, b); }
+inline float4 sub(const float4 a, const float4 b) { return vsubq_f32(a, b); }
+inline float4 mul(const float4 a, const float4 b) { return vmulq_f32(a, b); }
+inline float4 mulSign(const float4 a, const float4 sign)
+{
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vandq_u32(vreinterpretq_u32_f32(sign), vdupq_n_u32(0x80000000u))));
+}
+#if defined(__aarch64__) || defined(_M_ARM64)
+inline float4 div(const float4 a, const float4 b) { return vdivq_f32(a, b); }
+inline float4 sqrt(const float4 a) { return vsqrtq_f32(a); }
+#else
+inline float4 div(const float4 a, const float4 b)
+{
+    float4 reciprocal = vrecpeq_f32(b);
+    reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+    reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+    return vmulq_f32(a, reciprocal);
+}
+inline float4 sqrt(const float4 a)
+{
+    const uint32x4_t isZero = vceqq_f32(a, vdupq_n_f32(0));
+    float4 rsqrt = vrsqrteq_f32(a);
+    rsqrt = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, rsqrt), rsqrt), rsqrt);
+    rsqrt = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, rsqrt), rsqrt), rsqrt);
+    return vbslq_f32(isZero, a, vmulq_f32(a, rsqrt));
+}
+#endif
+
+#else
+
+struct float4
+{
+    float v[4];
+};
+
+inline float4 load(const float* p) { return float4{ { p[0], p[1], p[2], p[3] } }; }
+inline void store(float* p, const float4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+inline float4 loadUnaligned(const float* p) { return load(p); }
+inline void storeUnaligned(float* p, const float4 a) { store(p, a); }
+inline float4 set1(const float f) { return float4{ { f, f, f, f } }; }
+inline float4 add(const float4 a, const float4 b) { return float4{ { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+inline float4 sub(const float4 a, const float4 b) { return float4{ { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+inline float4 mul(const float4 a, const float4 b) { return float4{ { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+inline float4 div(const float4 a, const float4 b) { return float4{ { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+inline float4 sqrt(const float4 a) { return float4{ { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } }; }
+inline float4 mulSign(const float4 a, const float4 sign) { return float4{ { std::copysign(1.0f, sign.v[0]) * a.v[0], std::copysign(1.0f, sign.v[1]) * a.v[1], std::copysign(1.0f, sign.v[2]) * a.v[2], std::copysign(1.0f, sign.v[3]) * a.v[3] } }; }
+
+#endif
+
+inline float4 lerp(const float4 a, const float4 b, const float4 t)
+{
+    return add(a, mul(sub(b, a), t));
+}
+
+// out = a + (b - a) * t. Count must be a multiple of Width, all arrays must be 16-byte aligned
+inline void lerpArrays(const float* a, const float* b, const float t, float* out, const int count)
+{
+    const float4 t4 = set1(t);
+    for (int i = 0; i < count; i += Width)
+    {
+        store(out + i, lerp(load(a + i), load(b + i), t4));
+    }
+}
+
+// Normalizes quaternions stored as separate arrays of components. Count must be a multiple of Width
+inline void normalizeQuaternions(float* x, float* y, float* z, float* w, const int count)
+{
+    const float4 one = set1(1.0f);
+    const float4 epsilon = set1(1e-12f);
+    for (int i = 0; i < count; i += Width)
+    {
+        const float4 x4 = load(x + i);
+        const float4 y4 = load(y + i);
+        const float4 z4 = load(z + i);
+        const float4 w4 = load(w + i);
+
+        const float4 lengthSquared = add(add(mul(x4, x4), mul(y4, y4)), add(add(mul(z4, z4), mul(w4, w4)), epsilon));
+        const float4 inverseLength = div(one, sqrt(lengthSquared));
+
+        store(x + i, mul(x4, inverseLength));
+        store(y + i, mul(y4, inverseLength));
+        store(z + i, mul(z4, inverseLength));
+        store(w + i, mul(w4, inverseLength));
+    }
+}
+
+}
+
+}
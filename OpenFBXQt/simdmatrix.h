@@ -0,0 +1,138 @@
+#pragma once
+
+#include "simd.h"
+#include <QMatrix4x4>
+#include <QQuaternion>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace ofbxqt
+{
+
+namespace simd
+{
+
+// Kernels for column-major 4x4 matrices laid out as QMatrix4x4::constData(). Matrices do not have to be aligned
+
+// out = a * b, out may alias a or b
+inline void multiply(const float* a, const float* b, float* out)
+{
+#if defined(__AVX__)
+    const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 0));
+    const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+    const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+    const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+
+    // two columns of b per iteration
+    for (int column = 0; column < 4; column += 2)
+    {
+        const __m256 b01 = _mm256_loadu_ps(b + column * 4);
+
+        __m256 result = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+        result = _mm256_add_ps(result, _mm256_mul_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55)));
+        result = _mm256_add_ps(result, _mm256_mul_ps(a2, _mm256_shuffle_ps(b01, b01, 0xAA)));
+        result = _mm256_add_ps(result, _mm256_mul_ps(a3, _mm256_shuffle_ps(b01, b01, 0xFF)));
+
+        _mm256_storeu_ps(out + column * 4, result);
+    }
+#else
+    const float4 a0 = loadUnaligned(a + 0);
+    const float4 a1 = loadUnaligned(a + 4);
+    const float4 a2 = loadUnaligned(a + 8);
+    const float4 a3 = loadUnaligned(a + 12);
+
+    for (int column = 0; column < 4; ++column)
+    {
+        const float* b_ = b + column * 4;
+
+        float4 result = mul(a0, set1(b_[0]));
+        result = add(result, mul(a1, set1(b_[1])));
+        result = add(result, mul(a2, set1(b_[2])));
+        result = add(result, mul(a3, set1(b_[3])));
+
+        storeUnaligned(out + column * 4, result);
+    }
+#endif
+}
+
+inline QMatrix4x4 multiply(const QMatrix4x4& a, const QMatrix4x4& b)
+{
+    QMatrix4x4 result;
+    multiply(a.constData(), b.constData(), result.data());
+    return result;
+}
+
+// out[i] = a * b[i]
+inline void multiplyArray(const QMatrix4x4& a, const QMatrix4x4* b, QMatrix4x4* out, const int count)
+{
+    const float* a_ = a.constData();
+    for (int i = 0; i < count; ++i)
+    {
+        multiply(a_, b[i].constData(), out[i].data());
+    }
+}
+
+// out[i] = a[i] * b[i]
+inline void multiplyArrays(const QMatrix4x4* a, const QMatrix4x4* b, QMatrix4x4* out, const int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        multiply(a[i].constData(), b[i].constData(), out[i].data());
+    }
+}
+
+// out = translation * rotation * scale, rotation is a unit quaternion (x, y, z, w)
+inline void composeTRS(const float* translation, const float* rotation, const float* scale, float* out)
+{
+    const float x = rotation[0];
+    const float y = rotation[1];
+    const float z = rotation[2];
+    const float w = rotation[3];
+
+    const float xx = x * x;
+    const float yy = y * y;
+    const float zz = z * z;
+    const float xy = x * y;
+    const float xz = x * z;
+    const float yz = y * z;
+    const float wx = w * x;
+    const float wy = w * y;
+    const float wz = w * z;
+
+    out[0] = (1 - 2 * (yy + zz)) * scale[0];
+    out[1] = 2 * (xy + wz) * scale[0];
+    out[2] = 2 * (xz - wy) * scale[0];
+    out[3] = 0;
+
+    out[4] = 2 * (xy - wz) * scale[1];
+    out[5] = (1 - 2 * (xx + zz)) * scale[1];
+    out[6] = 2 * (yz + wx) * scale[1];
+    out[7] = 0;
+
+    out[8] = 2 * (xz + wy) * scale[2];
+    out[9] = 2 * (yz - wx) * scale[2];
+    out[10] = (1 - 2 * (xx + yy)) * scale[2];
+    out[11] = 0;
+
+    out[12] = translation[0];
+    out[13] = translation[1];
+    out[14] = translation[2];
+    out[15] = 1;
+}
+
+inline QMatrix4x4 composeTRS(const QVector3D& translation, const QQuaternion& rotation, const QVector3D& scale)
+{
+    const float translation_[3] = { translation.x(), translation.y(), translation.z() };
+    const float rotation_[4] = { rotation.x(), rotation.y(), rotation.z(), rotation.scalar() };
+    const float scale_[3] = { scale.x(), scale.y(), scale.z() };
+
+    QMatrix4x4 result;
+    composeTRS(translation_, rotation_, scale_, result.data());
+    return result;
+}
+
+}
+
+}
@@ -0,0 +1,277 @@
+#include "texturecache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+
+namespace ofbxqt
+{
+
+struct TextureCacheHeader
+{
+    char magic[4];
+    quint32 version;
+    quint32 width;
+    quint32 height;
+    quint32 levelCount;
+    quint32 reserved;
+    qint64 sourceModified;
+    qint64 sourceSize;
+    char contentHash[20]; // SHA-1 of the source file
+    char padding[4];
+};
+
+static_assert(sizeof(TextureCacheHeader) == 64, "levels must start at an aligned offset");
+
+static const char TextureCacheMagic[4] = { 'O', 'F', 'Q', 'T' };
+
+TextureImage TextureImage::fromImage(const QImage& source)
+{
+    TextureImage result;
+
+    if (source.isNull())
+    {
+        return result;
+    }
+
+    const QImage image = source.mirrored().convertToFormat(QImage::Format_RGBA8888);
+
+    int levelCount = 1;
+    for (int size = qMax(image.width(), image.height()); size > 1; size >>= 1)
+    {
+        ++levelCount;
+    }
+
+    result.setLayout(image.width(), image.height(), levelCount);
+    result.ownedData.resize(int(result.size));
+
+    uchar* data = reinterpret_cast<uchar*>(result.ownedData.data());
+
+    const int lineSize = image.width() * 4;
+    for (int y = 0; y < image.height(); ++y)
+    {
+        std::memcpy(data + y * lineSize, image.constScanLine(y), size_t(lineSize));
+    }
+
+    for (int level = 1; level < levelCount; ++level)
+    {
+        const uchar* source = data + result.levelOffsets[level - 1];
+        uchar* destination = data + result.levelOffsets[level];
+
+        const int sourceWidth = result.getWidth(level - 1);
+        const int sourceHeight = result.getHeight(level - 1);
+        const int width = result.getWidth(level);
+        const int height = result.getHeight(level);
+
+        for (int y = 0; y < height; ++y)
+        {
+            const uchar* row0 = source + qMin(y * 2, sourceHeight - 1) * sourceWidth * 4;
+            const uchar* row1 = source + qMin(y * 2 + 1, sourceHeight - 1) * sourceWidth * 4;
+
+            for (int x = 0; x < width; ++x)
+            {
+                const int x0 = qMin(x * 2, sourceWidth - 1) * 4;
+                const int x1 = qMin(x * 2 + 1, sourceWidth - 1) * 4;
+
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    *destination++ = uchar((row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel] + 2) / 4);
+                }
+            }
+        }
+    }
+
+    result.data = reinterpret_cast<const uchar*>(result.ownedData.constData());
+
+    return result;
+}
+
+void TextureImage::setLayout(const int width_, const int height_, const int levelCount_)
+{
+    width = width_;
+    height = height_;
+    levelCount = levelCount_;
+
+    levelOffsets.resize(levelCount);
+    size = 0;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        levelOffsets[level] = size;
+        size += getLevelSize(level);
+    }
+}
+
+TextureImage TextureCache::load(const QString& fileName, const QString& cacheDirectory)
+{
+    if (cacheDirectory.isEmpty())
+    {
+        return TextureImage::fromImage(QImage(fileName));
+    }
+
+    QFile source(fileName);
+    if (!source.open(QIODevice::ReadOnly))
+    {
+        qCritical() << Q_FUNC_INFO << "failed to open" << fileName << ", error:" << source.errorString();
+        return TextureImage();
+    }
+
+    // hashing the source is much cheaper than decoding it
+    const QByteArray bytes = source.readAll();
+    const QByteArray contentHash = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+    const QFileInfo sourceInfo(fileName);
+    const qint64 sourceModified = sourceInfo.lastModified().toMSecsSinceEpoch();
+    const QString entryFileName = getEntryFileName(sourceInfo.absoluteFilePath(), cacheDirectory);
+
+    return decode(bytes, entryFileName, sourceModified, contentHash);
+}
+
+TextureImage TextureCache::loadFromData(const QByteArray& data, const QByteArray& contentHash, const QString& cacheDirectory)
+{
+    if (cacheDirectory.isEmpty())
+    {
+        return TextureImage::fromImage(QImage::fromData(data));
+    }
+
+    const QString entryFileName = getEntryFileName("embedded:" + QString::fromLatin1(contentHash.toHex()), cacheDirectory);
+
+    return decode(data, entryFileName, 0, contentHash);
+}
+
+TextureImage TextureCache::decode(const QByteArray& data, const QString& entryFileName, const qint64 sourceModified, const QByteArray& contentHash)
+{
+    TextureImage image = read(entryFileName, sourceModified, data.size(), contentHash);
+    if (!image.isNull())
+    {
+        return image;
+    }
+
+    image = TextureImage::fromImage(QImage::fromData(data));
+    if (image.isNull())
+    {
+        return image;
+    }
+
+    if (!write(entryFileName, image, sourceModified, data.size(), contentHash))
+    {
+        qWarning() << Q_FUNC_INFO << "failed to write cache entry" << entryFileName;
+    }
+
+    return image;
+}
+
+bool TextureCache::clear(const QString& cacheDirectory)
+{
+    QDir dir(cacheDirectory);
+
+    bool result = true;
+    for (const QString& entry : dir.entryList(QStringList("*.ofqtex"), QDir::Files))
+    {
+        result = dir.remove(entry) && result;
+    }
+
+    return result;
+}
+
+QString TextureCache::getEntryFileName(const QString& key, const QString& cacheDirectory)
+{
+    const QByteArray keyHash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDirectory + "/" + QString::fromLatin1(keyHash) + ".ofqtex";
+}
+
+TextureImage TextureCache::read(const QString& entryFileName, const qint64 sourceModified, const qint64 sourceSize, const QByteArray& contentHash)
+{
+    std::shared_ptr<QFile> file = std::make_shared<QFile>(entryFileName);
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        return TextureImage();
+    }
+
+    TextureCacheHeader header;
+    if (file->read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header)))
+    {
+        return TextureImage();
+    }
+
+    if (std::memcmp(header.magic, TextureCacheMagic, sizeof(header.magic)) != 0 || header.version != Version
+            || header.sourceModified != sourceModified || header.sourceSize != sourceSize
+            || contentHash.size() != int(sizeof(header.contentHash))
+            || std::memcmp(header.contentHash, contentHash.constData(), sizeof(header.contentHash)) != 0)
+    {
+        return TextureImage();
+    }
+
+    if (header.width == 0 || header.height == 0 || header.levelCount == 0 || header.levelCount > 32)
+    {
+        qWarning() << Q_FUNC_INFO << "invalid cache entry" << entryFileName;
+        return TextureImage();
+    }
+
+    TextureImage image;
+    image.setLayout(int(header.width), int(header.height), int(header.levelCount));
+
+    if (file->size() != qint64(sizeof(header)) + image.size)
+    {
+        qWarning() << Q_FUNC_INFO << "truncated cache entry" << entryFileName;
+        return TextureImage();
+    }
+
+    // the mapping lives as long as the file object, which is shared by copies of the image
+    const uchar* mapped = file->map(sizeof(header), image.size);
+    if (mapped)
+    {
+        image.data = mapped;
+        image.mappedFile = file;
+        return image;
+    }
+
+    image.ownedData = file->read(image.size);
+    if (image.ownedData.size() != image.size)
+    {
+        return TextureImage();
+    }
+
+    image.data = reinterpret_cast<const uchar*>(image.ownedData.constData());
+
+    return image;
+}
+
+bool TextureCache::write(const QString& entryFileName, const TextureImage& image, const qint64 sourceModified, const qint64 sourceSize, const QByteArray& contentHash)
+{
+    if (!QDir().mkpath(QFileInfo(entryFileName).absolutePath()))
+    {
+        return false;
+    }
+
+    TextureCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TextureCacheMagic, sizeof(header.magic));
+    header.version = Version;
+    header.width = quint32(image.width);
+    header.height = quint32(image.height);
+    header.levelCount = quint32(image.levelCount);
+    header.sourceModified = sourceModified;
+    header.sourceSize = sourceSize;
+    std::memcpy(header.contentHash, contentHash.constData(), qMin(sizeof(header.contentHash), size_t(contentHash.size())));
+
+    // other processes see either the old entry or the complete new one
+    QSaveFile file(entryFileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    if (file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != qint64(sizeof(header))
+            || file.write(reinterpret_cast<const char*>(image.data), image.size) != image.size)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QVector>
+#include <memory>
+
+class QFile;
+
+namespace ofbxqt
+{
+
+// RGBA8 image flipped for OpenGL with its whole mip chain, ready for upload. The data is held in
+// memory or mapped from a file of the texture cache
+class TextureImage
+{
+public:
+    TextureImage() {}
+
+    // Flips, converts and builds mip levels with a box filter
+    static TextureImage fromImage(const QImage& image);
+
+    bool isNull() const { return levelCount == 0; }
+    int getLevelCount() const { return levelCount; }
+    int getWidth(const int level = 0) const { return qMax(1, width >> level); }
+    int getHeight(const int level = 0) const { return qMax(1, height >> level); }
+    const uchar* getLevelData(const int level) const { return data + levelOffsets[level]; }
+    qint64 getLevelSize(const int level) const { return qint64(getWidth(level)) * getHeight(level) * 4; }
+    qint64 getSizeInBytes() const { return size; }
+
+private:
+    friend class TextureCache;
+
+    void setLayout(const int width, const int height, const int levelCount);
+
+    int width = 0;
+    int height = 0;
+    int levelCount = 0;
+    QVector<qint64> levelOffsets;
+    qint64 size = 0;
+
+    const uchar* data = nullptr;
+    QByteArray ownedData;
+    std::shared_ptr<QFile> mappedFile;
+};
+
+// Directory of decoded textures. An entry belongs to the absolute path of the source image and is used
+// while the modification time, the size and the content hash of the source match
+class TextureCache
+{
+public:
+    // Reads the image from the cache or decodes it and stores it in the cache. An empty directory
+    // disables the cache. Thread safe, called from the decoding pool of the loader
+    static TextureImage load(const QString& fileName, const QString& cacheDirectory);
+    // For images embedded in a model file. Entries are keyed by the SHA-1 of the data, so the same image
+    // embedded in several files is decoded once
+    static TextureImage loadFromData(const QByteArray& data, const QByteArray& contentHash, const QString& cacheDirectory);
+
+    // Removes all entries of the directory
+    static bool clear(const QString& cacheDirectory);
+
+private:
+    static const quint32 Version = 1;
+
+    static QString getEntryFileName(const QString& key, const QString& cacheDirectory);
+    static TextureImage decode(const QByteArray& data, const QString& entryFileName, const qint64 sourceModified, const QByteArray& contentHash);
+    static TextureImage read(const QString& entryFileName, const qint64 sourceModified, const qint64 sourceSize, const QByteArray& contentHash);
+    static bool write(const QString& entryFileName, const TextureImage& image, const qint64 sourceModified, const qint64 sourceSize, const QByteArray& contentHash);
+};
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QAtomicInt>
+
+namespace ofbxqt
+{
+
+// Lock-free exchange of values between one writer and one reader. The writer fills getWriteBuffer()
+// and publishes it, the reader always gets the newest published value and owns it until the next read
+template <typename T>
+class TripleBuffer
+{
+public:
+    T& getWriteBuffer() { return buffers[writeIndex]; }
+
+    void publish()
+    {
+        writeIndex = latest.fetchAndStoreOrdered(writeIndex | NewFlag) & IndexMask;
+    }
+
+    const T& getReadBuffer()
+    {
+        if (latest.loadAcquire() & NewFlag)
+        {
+            readIndex = latest.fetchAndStoreOrdered(readIndex) & IndexMask;
+        }
+
+        return buffers[readIndex];
+    }
+
+    // Both sides must be idle
+    void reset(const T& value = T())
+    {
+        for (T& buffer : buffers)
+        {
+            buffer = value;
+        }
+    }
+
+private:
+    static const int IndexMask = 0x3;
+    static const int NewFlag = 0x4;
+
+    T buffers[3];
+    int writeIndex = 0;
+    int readIndex = 1;
+    QAtomicInt latest = 2;
+};
+
+}
@@ -0,0 +1,106 @@
+#include "uploadqueue.h"
+#include "model.h"
+
+namespace ofbxqt
+{
+
+UploadBudget::UploadBudget(const double milliseconds, const qint64 bytes)
+    : nanoseconds(milliseconds >= 0 ? qint64(milliseconds * 1000000) : -1)
+    , bytesLeft(bytes)
+{
+    if (nanoseconds >= 0)
+    {
+        timer.start();
+    }
+}
+
+bool UploadBudget::isExhausted() const
+{
+    if (bytesLeft == 0)
+    {
+        return true;
+    }
+
+    return nanoseconds >= 0 && timer.nsecsElapsed() >= nanoseconds;
+}
+
+qint64 UploadBudget::take(const qint64 remainingBytes, const qint64 granularity)
+{
+    qint64 chunk = remainingBytes;
+
+    if (bytesLeft >= 0)
+    {
+        chunk = qMin(chunk, qMax(bytesLeft, MinChunkSize));
+    }
+
+    if (nanoseconds >= 0)
+    {
+        chunk = qMin(chunk, MaxTimedChunkSize);
+    }
+
+    if (chunk < remainingBytes && granularity > 1)
+    {
+        chunk = qMin(remainingBytes, qMax(granularity, chunk - chunk % granularity));
+    }
+
+    consume(chunk);
+
+    return chunk;
+}
+
+void UploadBudget::consume(const qint64 bytes)
+{
+    bytesTransferred += bytes;
+
+    if (bytesLeft >= 0)
+    {
+        bytesLeft = qMax(qint64(0), bytesLeft - bytes);
+    }
+}
+
+void UploadQueue::setFrameBudget(const double milliseconds_, const qint64 bytes_)
+{
+    milliseconds = milliseconds_;
+    bytes = bytes_;
+}
+
+void UploadQueue::enqueue(std::shared_ptr<Model> model)
+{
+    if (!model)
+    {
+        qCritical() << Q_FUNC_INFO << "model is null";
+        return;
+    }
+
+    if (!models.contains(model))
+    {
+        models.append(model);
+    }
+}
+
+void UploadQueue::clear()
+{
+    models.clear();
+}
+
+bool UploadQueue::process()
+{
+    UploadBudget budget(milliseconds, bytes);
+
+    int done = 0;
+    while (done < models.count() && !budget.isExhausted())
+    {
+        if (!models[done]->uploadGL(budget))
+        {
+            break;
+        }
+
+        ++done;
+    }
+
+    models.remove(0, done);
+
+    return models.isEmpty();
+}
+
+}
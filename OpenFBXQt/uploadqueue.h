@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QVector>
+#include <memory>
+
+namespace ofbxqt
+{
+
+class Model;
+
+// Limits the time and the amount of data transferred to OpenGL in one frame.
+// Negative limits mean no limit
+class UploadBudget
+{
+public:
+    UploadBudget(const double milliseconds = -1, const qint64 bytes = -1);
+
+    bool isExhausted() const;
+
+    // Size of the next chunk of a transfer with remainingBytes left, the chunk is taken from the budget.
+    // The chunk is a multiple of granularity unless the remainder is smaller
+    qint64 take(const qint64 remainingBytes, const qint64 granularity = 1);
+    // For work that can not be split, like texture conversion or a shader build
+    void consume(const qint64 bytes);
+
+    qint64 getBytesTransferred() const { return bytesTransferred; }
+
+private:
+    // Smaller chunks cost more in calls than they save in time
+    static const qint64 MinChunkSize = 64 * 1024;
+    // With a time limit chunks are small enough to check the clock often
+    static const qint64 MaxTimedChunkSize = 1024 * 1024;
+
+    QElapsedTimer timer;
+    qint64 nanoseconds = -1;
+    qint64 bytesLeft = -1;
+    qint64 bytesTransferred = 0;
+};
+
+// Streams buffers and textures of models to OpenGL over several frames, so opening a large file does not
+// stall drawing. A model is drawn as soon as all its data is resident. Used from the OpenGL thread only
+class UploadQueue
+{
+public:
+    void setFrameBudget(const double milliseconds, const qint64 bytes);
+    double getFrameBudgetMilliseconds() const { return milliseconds; }
+    qint64 getFrameBudgetBytes() const { return bytes; }
+
+    void enqueue(std::shared_ptr<Model> model);
+    void clear();
+    bool isEmpty() const { return models.isEmpty(); }
+    int count() const { return models.count(); }
+
+    // Uploads models in order until the budget of a frame is spent, returns true when everything is resident
+    bool process();
+
+private:
+    double milliseconds = 4;
+    qint64 bytes = 16 * 1024 * 1024;
+
+    QVector<std::shared_ptr<Model>> models;
+};
+
+}
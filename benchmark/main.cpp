@@ -0,0 +1,341 @@
+#include "loader.h"
+#include "OpenFBX/src/ofbx.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <numeric>
+
+// Measures the stages of the loading pipeline separately over a set of files. The parser stages come from
+// the statistics of ofbx::load(), the stages of Loader are run on their own on the parsed scene
+
+namespace ofbxqt
+{
+
+// Friend of Loader, runs one stage of it at a time
+class LoaderBenchmark
+{
+public:
+    LoaderBenchmark(const QByteArray& data, const ofbx::IScene& scene_, const QString& directory_)
+        : scene(scene_)
+        , directory(directory_)
+    {
+        loader.fileData = data;
+    }
+
+    // Builds vertex and index data of every mesh, without joints and materials
+    double runMeshes()
+    {
+        reset();
+        loader.config.loadArmature = false;
+        loader.config.loadMaterial = false;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int i = 0; i < scene.getMeshCount(); ++i)
+        {
+            loader.loadMesh(scene.getMesh(i), i, directory);
+        }
+
+        return timer.nsecsElapsed() / 1000000.0;
+    }
+
+    // Joints and weights of every skin
+    double runJoints()
+    {
+        reset();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int i = 0; i < scene.getMeshCount(); ++i)
+        {
+            const ofbx::Geometry* geometry = scene.getMesh(i)->getGeometry();
+            if (geometry && geometry->getSkin())
+            {
+                ModelData data;
+                QHash<GLuint, QVector<QPair<GLuint, GLfloat>>> jointsData;
+                loader.loadJoints(geometry->getSkin(), data, jointsData);
+            }
+        }
+
+        return timer.nsecsElapsed() / 1000000.0;
+    }
+
+    // Diffuse textures of every material including decoding, without the texture cache
+    double runTextures()
+    {
+        reset();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int i = 0; i < scene.getMeshCount(); ++i)
+        {
+            const ofbx::Mesh* mesh = scene.getMesh(i);
+            for (int j = 0; j < mesh->getMaterialCount(); ++j)
+            {
+                const ofbx::Texture* texture = mesh->getMaterial(j)->getTexture(ofbx::Texture::DIFFUSE);
+                if (texture)
+                {
+                    ModelCache::TextureReference reference;
+                    loader.loadTexture(texture, directory, i, j, ofbx::Texture::DIFFUSE, reference);
+                }
+            }
+        }
+
+        loader.joinTextures();
+
+        return timer.nsecsElapsed() / 1000000.0;
+    }
+
+private:
+    void reset()
+    {
+        loader.config = OpenModelConfig();
+        loader.fileInfo = FileInfo();
+        loader.jointBindings.clear();
+        loader.pendingTextures.clear();
+        loader.textureReferences.clear();
+        loader.textureNotes.clear();
+        loader.modelsByObjects.clear();
+
+        // nothing is shared between iterations
+        loader.storage.clear();
+    }
+
+    Loader loader;
+    const ofbx::IScene& scene;
+    const QString directory;
+};
+
+}
+
+struct Stage
+{
+    QString name;
+    QVector<double> samples; // in milliseconds
+};
+
+static QStringList collectFiles(const QStringList& paths)
+{
+    QStringList result;
+
+    for (const QString& path : paths)
+    {
+        const QFileInfo info(path);
+        if (info.isFile())
+        {
+            result.append(info.absoluteFilePath());
+            continue;
+        }
+
+        QStringList files;
+        QDirIterator it(path, QStringList("*.fbx"), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext())
+        {
+            files.append(QFileInfo(it.next()).absoluteFilePath());
+        }
+
+        std::sort(files.begin(), files.end());
+        result.append(files);
+    }
+
+    return result;
+}
+
+static double getMedian(QVector<double> samples)
+{
+    if (samples.isEmpty())
+    {
+        return 0;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    const int middle = samples.count() / 2;
+    return samples.count() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+}
+
+static void messageHandler(QtMsgType type, const QMessageLogContext&, const QString& message)
+{
+    // notes of broken files would be printed on every iteration
+    if (type == QtFatalMsg)
+    {
+        QTextStream(stderr) << message << "\n";
+        abort();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ofbxqt-benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the stages of the loading pipeline, the result is the minimum, median, mean and maximum time of every stage in milliseconds");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "FBX files or directories searched recursively, for example example_models", "paths...");
+
+    const QCommandLineOption iterationsOption(QStringList({ "n", "iterations" }), "Measured iterations, 10 by default", "count", "10");
+    const QCommandLineOption warmupOption("warmup", "Iterations before the measured ones, 1 by default", "count", "1");
+    const QCommandLineOption formatOption(QStringList({ "f", "format" }), "csv or json, csv by default", "format", "csv");
+    const QCommandLineOption outputOption(QStringList({ "o", "output" }), "Writes the result to the file instead of the standard output", "file");
+    const QCommandLineOption verboseOption("verbose", "Prints messages of the loader");
+    parser.addOption(iterationsOption);
+    parser.addOption(warmupOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.addOption(verboseOption);
+
+    parser.process(app);
+
+    const QStringList files = collectFiles(parser.positionalArguments());
+    if (files.isEmpty())
+    {
+        parser.showHelp(2);
+    }
+
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const int warmup = qMax(0, parser.value(warmupOption).toInt());
+    const bool json = parser.value(formatOption) == "json";
+
+    if (!parser.isSet(verboseOption))
+    {
+        qInstallMessageHandler(messageHandler);
+    }
+
+    QString csv = "file,format,stage,iterations,min_ms,median_ms,mean_ms,max_ms\n";
+    QJsonArray reports;
+
+    for (const QString& fileName : files)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            QTextStream(stderr) << "failed to open " << fileName << ", error: " << file.errorString() << "\n";
+            return 2;
+        }
+
+        const QByteArray data = file.readAll();
+        const QString format = data.startsWith("Kaydara FBX Binary") ? "binary" : "text";
+        const QString directory = QFileInfo(fileName).absolutePath();
+
+        QVector<Stage> stages;
+        for (const char* name : { "ofbx::load", "tokenize", "parseConnections", "parseTakes", "parseObjects", "parseGeometry", "inflate",
+                                  "Loader::loadMesh", "Loader::loadJoints", "Loader::loadTexture" })
+        {
+            Stage stage;
+            stage.name = name;
+            stages.append(stage);
+        }
+
+        ofbx::LoadStatistics statistics;
+        bool loaded = true;
+
+        for (int iteration = 0; iteration < warmup + iterations && loaded; ++iteration)
+        {
+            QElapsedTimer timer;
+            timer.start();
+
+            ofbx::IScene* scene = ofbx::load((const ofbx::u8*)data.constData(), data.size(),
+                                             (ofbx::u64)ofbx::LoadFlags::TRIANGULATE | (ofbx::u64)ofbx::LoadFlags::NO_DATA_COPY);
+
+            const double loadTime = timer.nsecsElapsed() / 1000000.0;
+
+            if (!scene)
+            {
+                QTextStream(stderr) << "failed to load " << fileName << ", error: " << ofbx::getError() << "\n";
+                loaded = false;
+                break;
+            }
+
+            statistics = scene->getLoadStatistics();
+
+            double times[] = { loadTime, statistics.tokenize_time * 1000, statistics.connections_time * 1000, statistics.takes_time * 1000,
+                               statistics.objects_time * 1000, statistics.geometry_time * 1000, statistics.inflate_time * 1000, 0, 0, 0 };
+
+            {
+                ofbxqt::LoaderBenchmark benchmark(data, *scene, directory);
+                times[7] = benchmark.runMeshes();
+                times[8] = benchmark.runJoints();
+                times[9] = benchmark.runTextures();
+            }
+
+            scene->destroy();
+
+            if (iteration >= warmup)
+            {
+                for (int i = 0; i < stages.count(); ++i)
+                {
+                    stages[i].samples.append(times[i]);
+                }
+            }
+        }
+
+        if (!loaded)
+        {
+            continue;
+        }
+
+        QJsonArray stageReports;
+        for (const Stage& stage : qAsConst(stages))
+        {
+            const double min = *std::min_element(stage.samples.begin(), stage.samples.end());
+            const double max = *std::max_element(stage.samples.begin(), stage.samples.end());
+            const double mean = std::accumulate(stage.samples.begin(), stage.samples.end(), 0.0) / stage.samples.count();
+            const double median = getMedian(stage.samples);
+
+            csv += QString("\"%1\",%2,%3,%4,%5,%6,%7,%8\n").arg(fileName, format, stage.name).arg(stage.samples.count())
+                    .arg(min, 0, 'f', 3).arg(median, 0, 'f', 3).arg(mean, 0, 'f', 3).arg(max, 0, 'f', 3);
+
+            QJsonObject stageReport;
+            stageReport.insert("stage", stage.name);
+            stageReport.insert("minMs", min);
+            stageReport.insert("medianMs", median);
+            stageReport.insert("meanMs", mean);
+            stageReport.insert("maxMs", max);
+            stageReports.append(stageReport);
+        }
+
+        QJsonObject report;
+        report.insert("file", fileName);
+        report.insert("format", format);
+        report.insert("bytes", double(data.size()));
+        report.insert("compressedBytes", double(statistics.compressed_bytes));
+        report.insert("inflatedBytes", double(statistics.inflated_bytes));
+        report.insert("arenaBytes", double(statistics.arena_bytes));
+        report.insert("iterations", iterations);
+        report.insert("stages", stageReports);
+        reports.append(report);
+    }
+
+    const QByteArray result = json ? QJsonDocument(reports).toJson(QJsonDocument::Indented) : csv.toUtf8();
+
+    QFile output;
+    if (parser.isSet(outputOption))
+    {
+        output.setFileName(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            QTextStream(stderr) << "failed to write " << output.fileName() << ", error: " << output.errorString() << "\n";
+            return 2;
+        }
+    }
+    else
+    {
+        output.open(stdout, QIODevice::WriteOnly);
+    }
+
+    output.write(result);
+
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include "loader.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+
+// Loads FBX files without a display or an OpenGL context and prints a JSON report, for validation of assets
+// on build servers. With a model cache directory the post-processed models are written for the viewer
+
+static QString noteTypeToString(const ofbxqt::Note::Type type)
+{
+    switch (type)
+    {
+    case ofbxqt::Note::Type::Info: return "info";
+    case ofbxqt::Note::Type::Warning: return "warning";
+    case ofbxqt::Note::Type::Error: return "error";
+    }
+
+    return "unknown";
+}
+
+static QJsonObject phaseToJson(const ofbxqt::PhaseTime& phase)
+{
+    QJsonObject result;
+    result.insert("wallMs", phase.wallMs);
+    result.insert("cpuMs", phase.cpuMs);
+    return result;
+}
+
+static QJsonObject statisticsToJson(const ofbxqt::LoadStatistics& statistics)
+{
+    QJsonObject phases;
+    phases.insert("read", phaseToJson(statistics.read));
+    phases.insert("tokenize", phaseToJson(statistics.tokenize));
+    phases.insert("inflate", phaseToJson(statistics.inflate));
+    phases.insert("objects", phaseToJson(statistics.objects));
+    phases.insert("geometry", phaseToJson(statistics.geometry));
+    phases.insert("meshes", phaseToJson(statistics.meshes));
+    phases.insert("skin", phaseToJson(statistics.skin));
+    phases.insert("materials", phaseToJson(statistics.materials));
+    phases.insert("textures", phaseToJson(statistics.textures));
+    phases.insert("animations", phaseToJson(statistics.animations));
+
+    QJsonObject result;
+    result.insert("total", phaseToJson(statistics.total));
+    result.insert("phases", phases);
+    result.insert("fromModelCache", statistics.fromModelCache);
+    result.insert("bytesRead", double(statistics.bytesRead));
+    result.insert("compressedBytes", double(statistics.compressedBytes));
+    result.insert("inflatedBytes", double(statistics.inflatedBytes));
+    result.insert("arenaBytes", double(statistics.arenaBytes));
+    result.insert("estimatedPeakBytes", double(statistics.estimatedPeakBytes));
+    result.insert("vertexBytes", double(statistics.vertexBytes));
+    result.insert("indexBytes", double(statistics.indexBytes));
+    result.insert("textureBytes", double(statistics.textureBytes));
+    return result;
+}
+
+static QStringList collectFiles(const QStringList& paths, bool& ok)
+{
+    QStringList result;
+    ok = true;
+
+    for (const QString& path : paths)
+    {
+        const QFileInfo info(path);
+        if (info.isFile())
+        {
+            result.append(info.absoluteFilePath());
+        }
+        else if (info.isDir())
+        {
+            QStringList files;
+            QDirIterator it(path, QStringList("*.fbx"), QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext())
+            {
+                files.append(QFileInfo(it.next()).absoluteFilePath());
+            }
+
+            std::sort(files.begin(), files.end());
+            result.append(files);
+        }
+        else
+        {
+            qCritical().noquote() << "not found:" << path;
+            ok = false;
+        }
+    }
+
+    return result;
+}
+
+static QJsonObject inspectFile(const QString& fileName, const ofbxqt::OpenModelConfig& config, const bool strict)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // the loader keeps its own store, so the data of the file is released when it has been inspected
+    const ofbxqt::FileInfo fileInfo = ofbxqt::Loader().open(fileName, config);
+
+    const double timeMs = timer.nsecsElapsed() / 1000000.0;
+
+    qint64 vertexCount = 0;
+    qint64 triangleCount = 0;
+    int jointCount = 0;
+    QSet<const ofbxqt::Armature*> armatures;
+    QSet<const ofbxqt::Material*> materials;
+    QSet<const ofbxqt::TextureInfo*> textures;
+
+    for (const std::shared_ptr<ofbxqt::Model>& model : fileInfo.allModels)
+    {
+        vertexCount += model->getVertexCount();
+        triangleCount += model->getIndexCount() / 3;
+
+        if (model->armature && !armatures.contains(model->armature.get()))
+        {
+            armatures.insert(model->armature.get());
+            jointCount += model->armature->getAllJoints().count();
+        }
+
+        const std::shared_ptr<ofbxqt::Material> material = model->getMaterial();
+        if (material)
+        {
+            materials.insert(material.get());
+
+            if (material->diffuseTexture)
+            {
+                textures.insert(material->diffuseTexture.get());
+            }
+        }
+    }
+
+    QJsonArray notes;
+    int errorCount = 0;
+    int warningCount = 0;
+    for (const ofbxqt::Note& note : fileInfo.notes)
+    {
+        QJsonObject object;
+        object.insert("type", noteTypeToString(note.getType()));
+        object.insert("text", note.getText());
+        notes.append(object);
+
+        if (note.getType() == ofbxqt::Note::Type::Error)
+        {
+            ++errorCount;
+        }
+        else if (note.getType() == ofbxqt::Note::Type::Warning)
+        {
+            ++warningCount;
+        }
+    }
+
+    const bool passed = !fileInfo.allModels.isEmpty() && errorCount == 0 && (!strict || warningCount == 0);
+
+    QJsonObject result;
+    result.insert("file", fileName);
+    result.insert("passed", passed);
+    result.insert("timeMs", timeMs);
+    result.insert("models", fileInfo.allModels.count());
+    result.insert("topLevelModels", fileInfo.topLevelModels.count());
+    result.insert("vertices", double(vertexCount));
+    result.insert("triangles", double(triangleCount));
+    result.insert("armatures", armatures.count());
+    result.insert("joints", jointCount);
+    result.insert("materials", materials.count());
+    result.insert("textures", textures.count());
+    result.insert("animations", fileInfo.animationClips.count());
+    result.insert("errors", errorCount);
+    result.insert("warnings", warningCount);
+    result.insert("statistics", statisticsToJson(fileInfo.statistics));
+    result.insert("notes", notes);
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ofbxqt-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Loads FBX files and prints a JSON report with counts, notes and timings of every file");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "FBX files or directories searched recursively", "paths...");
+
+    const QCommandLineOption jobsOption(QStringList({ "j", "jobs" }), "Files loaded in parallel, all cores by default", "count");
+    const QCommandLineOption outputOption(QStringList({ "o", "output" }), "Writes the report to the file instead of the standard output", "file");
+    const QCommandLineOption modelCacheOption("model-cache", "Writes post-processed models to the directory", "directory");
+    const QCommandLineOption textureCacheOption("texture-cache", "Writes decoded textures with mip levels to the directory", "directory");
+    const QCommandLineOption noAnimationOption("no-animation", "Skips animations");
+    const QCommandLineOption noTexturesOption("no-textures", "Skips textures");
+    const QCommandLineOption strictOption("strict", "Files with warnings fail too");
+    parser.addOption(jobsOption);
+    parser.addOption(outputOption);
+    parser.addOption(modelCacheOption);
+    parser.addOption(textureCacheOption);
+    parser.addOption(noAnimationOption);
+    parser.addOption(noTexturesOption);
+    parser.addOption(strictOption);
+
+    parser.process(app);
+
+    if (parser.positionalArguments().isEmpty())
+    {
+        parser.showHelp(2);
+    }
+
+    bool pathsFound = false;
+    const QStringList files = collectFiles(parser.positionalArguments(), pathsFound);
+    if (!pathsFound)
+    {
+        return 2;
+    }
+
+    ofbxqt::OpenModelConfig config;
+    config.loadAnimation = !parser.isSet(noAnimationOption);
+    config.loadDiffuseTexture = !parser.isSet(noTexturesOption);
+    config.modelCacheDirectory = parser.value(modelCacheOption);
+    config.textureCacheDirectory = parser.value(textureCacheOption);
+
+    const bool strict = parser.isSet(strictOption);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(parser.isSet(jobsOption) ? qMax(1, parser.value(jobsOption).toInt()) : QThread::idealThreadCount());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<QFuture<QJsonObject>> results;
+    for (const QString& fileName : files)
+    {
+        results.append(QtConcurrent::run(&pool, [fileName, config, strict]()
+        {
+            return inspectFile(fileName, config, strict);
+        }));
+    }
+
+    QJsonArray reports;
+    int failedCount = 0;
+    for (QFuture<QJsonObject>& result : results)
+    {
+        const QJsonObject report = result.result();
+        if (!report.value("passed").toBool())
+        {
+            ++failedCount;
+        }
+
+        reports.append(report);
+    }
+
+    QJsonObject summary;
+    summary.insert("files", reports);
+    summary.insert("fileCount", reports.count());
+    summary.insert("failedCount", failedCount);
+    summary.insert("jobs", pool.maxThreadCount());
+    summary.insert("timeMs", timer.nsecsElapsed() / 1000000.0);
+
+    const QByteArray json = QJsonDocument(summary).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption))
+    {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) || output.write(json) != json.size())
+        {
+            qCritical().noquote() << "failed to write" << output.fileName() << ", error:" << output.errorString();
+            return 2;
+        }
+    }
+    else
+    {
+        QFile output;
+        output.open(stdout, QIODevice::WriteOnly);
+        output.write(json);
+    }
+
+    return failedCount == 0 ? 0 : 1;
+}
@@ -7,6 +7,12 @@
 #include <QSlider>
 #include <QApplication>
 #include <QDoubleSpinBox>
+#include <QPushButton>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QProgressDialog>
+#include <QStandardPaths>
+#include <QTimer>
 
 namespace
 {
@@ -35,6 +41,16 @@ void clearLayout(QLayout& layout)
     }
 }
 
+QString formatMs(const double ms)
+{
+    return QString::number(ms, 'f', 1) + " ms";
+}
+
+QString formatBytes(const qint64 bytes)
+{
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 2) + " MB";
+}
+
 }
 
 MainWindow::MainWindow(QWidget *parent)
@@ -54,6 +70,8 @@ MainWindow::MainWindow(QWidget *parent)
 
     setWindowTitle(QCoreApplication::applicationName() + " (library version \"" + ofbxqt::VersionLib + "\")");
 
+    ui->sceneWidget->scene.setThreadedUpdate(true);
+
     ui->bottomPanelSplitter->setCollapsible(0, false);
     ui->bottomPanelSplitter->setSizes({ 100, 0 });
     ui->rightPanelSplitter->setSizes({ 1000, 240 });
@@ -81,6 +99,7 @@ void MainWindow::on_actionOpen_triggered()
 void MainWindow::on_actionClose_triggered()
 {
     ui->logWidget->clear();
+    ui->statisticsTree->clear();
     ofbxqt::Scene& scene = ui->sceneWidget->scene;
     scene.clear();
     ui->sceneWidget->resetCamera();
@@ -92,6 +111,11 @@ void MainWindow::on_actionExit_triggered()
     qApp->quit();
 }
 
+void MainWindow::on_actionFrameStatistics_toggled(bool checked)
+{
+    ui->sceneWidget->setStatisticsOverlayEnabled(checked);
+}
+
 void MainWindow::open(const QString &fileName)
 {
     addLogMessage(ofbxqt::Note(ofbxqt::Note::Type::Info, tr("Opening file \"%1\"").arg(fileName)));
@@ -99,9 +123,47 @@ void MainWindow::open(const QString &fileName)
     ofbxqt::Scene& scene = ui->sceneWidget->scene;
 
     ofbxqt::OpenModelConfig config;
+    config.textureCacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/textures";
+    config.modelCacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/models";
+
+    QProgressDialog* progressDialog = new QProgressDialog(tr("Opening file..."), tr("Cancel"), 0, 100, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(500);
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
+
+    const QPointer<MainWindow> window = this;
+    const QPointer<QProgressDialog> dialog = progressDialog;
+
+    const std::shared_ptr<ofbxqt::LoadTask> task = scene.openAsync(fileName, config, [window, dialog](const ofbxqt::FileInfo& fileInfo)
+    {
+        if (dialog)
+        {
+            dialog->deleteLater();
+        }
+
+        if (window)
+        {
+            window->onFileOpened(fileInfo);
+        }
+    });
+
+    connect(progressDialog, &QProgressDialog::canceled, progressDialog, [task]()
+    {
+        task->cancel();
+    });
 
-    const ofbxqt::FileInfo fileInfo = scene.open(fileName, config);
+    QTimer* progressTimer = new QTimer(progressDialog);
+    connect(progressTimer, &QTimer::timeout, progressDialog, [progressDialog, task]()
+    {
+        progressDialog->setLabelText(ofbxqt::LoadTask::phaseToString(task->getPhase()));
+        progressDialog->setValue(int(task->getProgress() * 100));
+    });
+    progressTimer->start(50);
+}
 
+void MainWindow::onFileOpened(const ofbxqt::FileInfo& fileInfo)
+{
     for (const ofbxqt::Note& note : qAsConst(fileInfo.notes))
     {
         addLogMessage(note);
@@ -116,9 +178,67 @@ void MainWindow::open(const QString &fileName)
         addLogMessage(ofbxqt::Note(ofbxqt::Note::Type::Info, tr("Opened %1 top level model(s)").arg(fileInfo.topLevelModels.count())));
     }
 
+    showStatistics(fileInfo);
     updateSceneTree();
 }
 
+void MainWindow::showStatistics(const ofbxqt::FileInfo& fileInfo)
+{
+    QTreeWidget& tree = *ui->statisticsTree;
+    tree.clear();
+
+    const ofbxqt::LoadStatistics& statistics = fileInfo.statistics;
+
+    QTreeWidgetItem* fileItem = new QTreeWidgetItem(&tree, { fileInfo.fileName + (statistics.fromModelCache ? tr(" (model cache)") : QString()),
+                                                             formatMs(statistics.total.wallMs), formatMs(statistics.total.cpuMs) });
+    QFont font = fileItem->font(0);
+    font.setBold(true);
+    fileItem->setFont(0, font);
+
+    const QVector<QPair<QString, const ofbxqt::PhaseTime*>> phases =
+    {
+        { tr("Read"), &statistics.read },
+        { tr("Tokenize"), &statistics.tokenize },
+        { tr("Inflate"), &statistics.inflate },
+        { tr("Objects"), &statistics.objects },
+        { tr("Geometry"), &statistics.geometry },
+        { tr("Meshes"), &statistics.meshes },
+        { tr("Skin"), &statistics.skin },
+        { tr("Materials"), &statistics.materials },
+        { tr("Textures"), &statistics.textures },
+        { tr("Animations"), &statistics.animations },
+    };
+
+    for (const QPair<QString, const ofbxqt::PhaseTime*>& phase : phases)
+    {
+        new QTreeWidgetItem(&tree, { phase.first, formatMs(phase.second->wallMs), formatMs(phase.second->cpuMs) });
+    }
+
+    const QVector<QPair<QString, QString>> values =
+    {
+        { tr("Bytes read"), formatBytes(statistics.bytesRead) },
+        { tr("Compressed"), formatBytes(statistics.compressedBytes) },
+        { tr("Inflated"), formatBytes(statistics.inflatedBytes) },
+        { tr("Arena"), formatBytes(statistics.arenaBytes) },
+        { tr("Peak (estimate)"), formatBytes(statistics.estimatedPeakBytes) },
+        { tr("Vertices"), QString::number(statistics.vertexCount) },
+        { tr("Indices"), QString::number(statistics.indexCount) },
+        { tr("Vertex data"), formatBytes(statistics.vertexBytes) },
+        { tr("Index data"), formatBytes(statistics.indexBytes) },
+        { tr("Texture data"), formatBytes(statistics.textureBytes) },
+    };
+
+    for (const QPair<QString, QString>& value : values)
+    {
+        new QTreeWidgetItem(&tree, { value.first, value.second });
+    }
+
+    for (int i = 0; i < tree.columnCount(); ++i)
+    {
+        tree.resizeColumnToContents(i);
+    }
+}
+
 void MainWindow::addLogMessage(const ofbxqt::Note &note)
 {
     QListWidgetItem* item = new QListWidgetItem(note.getText());
@@ -265,6 +385,29 @@ void MainWindow::updateInspector()
         layout.addLayout(titleLayout);
 
         layout.addWidget(new QLabel(tr("Models count: %1").arg(file->allModels.count()), this));
+
+        for (const std::shared_ptr<ofbxqt::AnimationClip>& clip : qAsConst(file->animationClips))
+        {
+            QPushButton* button = new QPushButton(tr("Play/pause \"%1\" (%2 s)").arg(clip->getName()).arg(clip->getDuration(), 0, 'f', 2), this);
+            layout.addWidget(button);
+            QObject::connect(button, &QPushButton::clicked, this, [this, clip]()
+            {
+                ofbxqt::Scene& scene = ui->sceneWidget->scene;
+
+                std::shared_ptr<ofbxqt::AnimationPlayer> player;
+                {
+                    QMutexLocker locker(&scene.getStateMutex());
+                    player = scene.getAnimationPlayer(clip);
+                    if (player && player->isPlaying())
+                    {
+                        player->pause();
+                        return;
+                    }
+                }
+
+                scene.playAnimation(clip);
+            });
+        }
     }
     else if (itemType == ItemType::Model)
     {
@@ -318,12 +461,22 @@ void MainWindow::updateInspector()
             layout.addWidget(new QLabel(tr("No material"), this));
         }
 
-        TransformWidget* transformWidget = new TransformWidget(model->getTransform());
+        ofbxqt::Transform transform;
+        {
+            QMutexLocker locker(&ui->sceneWidget->scene.getStateMutex());
+            transform = model->getTransform();
+        }
+
+        TransformWidget* transformWidget = new TransformWidget(transform);
         layout.addWidget(transformWidget);
         QObject::connect(transformWidget, &TransformWidget::transformChanged, this, [this, transformWidget, model]()
         {
-            model->setTransform(transformWidget->getTransform());
-            ui->sceneWidget->update();
+            ofbxqt::Scene& scene = ui->sceneWidget->scene;
+            {
+                QMutexLocker locker(&scene.getStateMutex());
+                model->setTransform(transformWidget->getTransform());
+            }
+            scene.requestUpdate();
         });
     }
     else if (itemType == ItemType::Armature)
@@ -352,13 +505,22 @@ void MainWindow::updateInspector()
         titleLayout->addItem(new QSpacerItem(10, 10, QSizePolicy::Policy::MinimumExpanding));
         layout.addLayout(titleLayout);
 
-        TransformWidget* transformWidget = new TransformWidget(joint->getTransform());
+        ofbxqt::Transform transform;
+        {
+            QMutexLocker locker(&ui->sceneWidget->scene.getStateMutex());
+            transform = joint->getTransform();
+        }
+
+        TransformWidget* transformWidget = new TransformWidget(transform);
         layout.addWidget(transformWidget);
         QObject::connect(transformWidget, &TransformWidget::transformChanged, this, [this, transformWidget, joint]()
         {
-            joint->setTransform(transformWidget->getTransform());
-            joint->armature.lock()->update();
-            ui->sceneWidget->update();
+            ofbxqt::Scene& scene = ui->sceneWidget->scene;
+            {
+                QMutexLocker locker(&scene.getStateMutex());
+                joint->setTransform(transformWidget->getTransform());
+            }
+            scene.requestUpdate();
         });
     }
     else
@@ -21,12 +21,15 @@ private slots:
     void on_actionOpen_triggered();
     void on_actionClose_triggered();
     void on_actionExit_triggered();
+    void on_actionFrameStatistics_toggled(bool checked);
 
     void on_sceneTree_currentItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous);
 
 private:
     void open(const QString& fileName);
+    void onFileOpened(const ofbxqt::FileInfo& fileInfo);
     void addLogMessage(const ofbxqt::Note& note);
+    void showStatistics(const ofbxqt::FileInfo& fileInfo);
     void updateSceneTree();
     QTreeWidgetItem* createModelItem(const std::shared_ptr<ofbxqt::Model>& model);
     void fillJointItem(QTreeWidgetItem& parentItem, const QVector<std::shared_ptr<ofbxqt::Joint>>& joints);